@@ -0,0 +1,156 @@
+// bench
+// By George Hill
+
+// Measures how fast libsmallsh parses lines and starts commands, by calling
+// the library directly instead of feeding lines to a running smallsh. Run it
+// with "make bench".
+
+// 80 Columns: /////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "libsmallsh.h"
+
+#define PARSE_COUNT 200000
+#define SPAWN_COUNT 2000
+#define BACKGROUND_COUNT 500
+// How many times each thing is done. Starting a process takes a few hundred
+// microseconds, and parsing a line a few hundred nanoseconds, so each test
+// takes about a second.
+
+#define PARSE_LINE \
+    "cat /tmp/$$.log | sort -r > /dev/null && echo done || echo failed ; true"
+#define PARSE_LINE_COMMANDS 4
+// A line with a bit of everything (except wildcards, which would make this a
+// benchmark of the current directory).
+
+// This function returns how many seconds have passed since "start":
+double secondsSince(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) +
+           (now.tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+// This function outputs one result: how many times per second something was
+// done, and how long each one took.
+void outputRate(int resultsFD, char* what, int count, double seconds)
+{
+    dprintf
+    (
+        resultsFD,
+        "%-36s %10.0f per second %10.2f us each\n",
+        what,
+        count / seconds,
+        seconds * 1000000.0 / count
+    );
+
+    return;
+}
+
+// This function runs "line" "count" times and outputs how fast that was. It
+// stops early (and says so) if the line doesn't succeed.
+void benchmarkRun
+(
+    struct smallshContext* shell,
+    int resultsFD,
+    char* what,
+    char* line,
+    int count
+)
+{
+    struct timespec start;
+    int exited;
+    int value;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++)
+    {
+        smallshRun(shell, line);
+        smallshGetStatus(shell, &exited, &value);
+        if (exited == FALSE || value != 0)
+        {
+            dprintf(resultsFD, "%-36s failed: \"%s\"\n", what, line);
+            return;
+        }
+    }
+
+    outputRate(resultsFD, what, count, secondsSince(&start));
+
+    return;
+}
+
+int main()
+{
+    // What the commands output, and the shell's reports about background
+    // processes, would get mixed up with the results, so stdout goes to
+    // /dev/null and the results go to where stdout was:
+    int resultsFD = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    if (resultsFD == -1 || devNull == -1)
+    {
+        perror("Error when setting up output!");
+        exit(1);
+    }
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    struct smallshContext* shell = smallshCreate(0);
+    struct timespec start;
+    int i;
+
+    if (shell == NULL)
+    {
+        exit(1); // smallshCreate() has already said why.
+    }
+
+    // Parsing (splitting, "$$", and lists), with nothing run:
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < PARSE_COUNT; i++)
+    {
+        if (smallshParse(shell, PARSE_LINE) != PARSE_LINE_COMMANDS)
+        {
+            dprintf(resultsFD, "parse failed: \"%s\"\n", PARSE_LINE);
+            exit(1);
+        }
+    }
+    outputRate(resultsFD, "parse a line", PARSE_COUNT, secondsSince(&start));
+
+    benchmarkRun(shell, resultsFD, "run a built-in (true)", "true",
+                 PARSE_COUNT);
+    benchmarkRun(shell, resultsFD, "run a program (/bin/true)", "/bin/true",
+                 SPAWN_COUNT);
+    benchmarkRun(shell, resultsFD, "run a 2-stage pipeline",
+                 "/bin/true | /bin/true", SPAWN_COUNT / 2);
+
+    // Background processes, all started and then all waited for:
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BACKGROUND_COUNT; i++)
+    {
+        smallshRun(shell, "/bin/true &");
+    }
+    smallshRun(shell, "wait");
+    if (smallshPollJobs(shell) != 0)
+    {
+        dprintf(resultsFD, "background processes were left running\n");
+    }
+    outputRate(resultsFD, "start and reap a background process",
+               BACKGROUND_COUNT, secondsSince(&start));
+
+    smallshDestroy(shell);
+
+    // The same, with a zygote starting the processes:
+    shell = smallshCreate(SMALLSH_USE_ZYGOTE);
+    benchmarkRun(shell, resultsFD, "run a program with the zygote",
+                 "/bin/true", SPAWN_COUNT);
+    smallshDestroy(shell);
+
+    return 0;
+}
@@ -0,0 +1,8420 @@
+// libsmallsh
+// By George Hill
+// CS 344
+// 2020-05-10
+
+// The shell itself: everything smallsh does except deciding where its
+// commands come from. See libsmallsh.h for how to use it, and smallsh.c for
+// the program.
+
+// 80 Columns: /////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE // For pipe2(), F_SETPIPE_SZ, and memfd_create().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
+#include <spawn.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ctype.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <limits.h>
+#include <dirent.h>
+
+#include "libsmallsh.h"
+
+#define FIRST_WORD_LIST_SIZE 64
+// Each line is split into an array of word pointers (see struct wordList).
+// The array starts with room for this many words and doubles whenever a line
+// has more, so there's no limit on the number of words other than the one
+// that the kernel puts on the arguments of a program (see
+// argumentsFitInArgMax()).
+#define MAX_ARGUMENT_LENGTH 131072
+// Linux also refuses to exec a program if any single argument (or environment
+// string) is longer than this: MAX_ARG_STRLEN, which is 32 pages.
+#define ARENA_BLOCK_SIZE 4096
+// The words themselves live in the buffer that the line was read into. Only
+// words that have to grow (because of "$$" expansion) are copied, and those
+// copies are carved out of blocks of this size that are reused at every prompt.
+#define GLOB_BUFFER_SIZE 262144
+#define FIRST_GLOB_MATCH_LIST_SIZE 64
+// Directories are read this many bytes of entries at a time when expanding
+// wildcards (see findGlobMatches()), and the list of matches starts with room
+// for this many names and doubles as needed.
+#define INPUT_BLOCK_SIZE 65536
+// Input is read this many bytes at a time (see readInputLine()).
+#define MAX_DIGITS_IN_PROCESS_ID 10 // Enough for any 32-bit pid.
+#define STATUS_REPORT_MAX_LENGTH 100
+
+#define EXIT_VALUE 1
+#define SIGNAL_RECEIVED 0
+// The statusType variable in the shell's context (struct smallshContext) will
+// track how the last foreground process terminated. If it exited normally, the
+// statusType variable will have the value EXIT_VALUE. If it exited because of
+// a signal, it will have the value SIGNAL_RECEIVED.
+
+#define COMMAND_AND_ARGUMENT_DELIMITER " " // Must use double-quotes.
+// We will use this to separate commands and arguments from each other.
+
+#define PROCESS_NUMBER_SYMBOL '$' // Must use single-quotes because used with
+                                  // character comparison.
+// We will use this to search for "$$" in the user's input.
+
+#define COMMENT_SYMBOL '#' // Must use single-quotes.
+// We will use this to identify comment lines.
+
+#define BACKGROUND_SYMBOL "&" // Must use double-quotes because used with
+                              // strcmp().
+// We will use this to identify commands that need to run in the background.
+
+#define PIPE_SYMBOL "|" // Must use double-quotes.
+// We will use this to separate the stages of a pipeline.
+
+#define LIST_SEPARATOR ";" // Must use double-quotes.
+#define AND_OPERATOR "&&" // Must use double-quotes.
+#define OR_OPERATOR "||" // Must use double-quotes.
+// We will use these to separate the commands of a list ("cmd1 ; cmd2 && cmd3
+// || cmd4"). Like the other symbols, they have to have spaces around them (a
+// word with one stuck to it is a syntax error; see hasGluedListOperator()).
+
+#define RUN_ALWAYS 0
+#define RUN_IF_SUCCEEDED 1
+#define RUN_IF_FAILED 2
+// Whether a command in a list runs depends on the operator before it: ";"
+// (or nothing, for the first command), "&&", or "||".
+
+#define PIPE_BUFFER_SIZE (1024 * 1024)
+// The pipes between pipeline stages are enlarged to this many bytes (with
+// F_SETPIPE_SZ), so that a fast writer has to wait for a slow reader less
+// often. 0 means keep the kernel's default size.
+
+#define REDIRECT_INPUT "<" // Must use double-quotes.
+#define REDIRECT_OUTPUT ">" // Must use double-quotes.
+// We will use these to identify commands that need file redirection.
+
+#define REDIRECT_HERE_STRING "<<<" // Must use double-quotes.
+#define REDIRECT_HERE_DOCUMENT "<<" // Must use double-quotes.
+// "cmd <<< WORD" gives the command WORD (and a newline) as its input, and
+// "cmd << END" (or "cmd <<END") gives it the lines that follow, up to one
+// that is just END (see collectHereDocuments()). Neither one touches the
+// filesystem (see openInputText()).
+
+#define DEV_NULL "/dev/null"
+// We will use this with certain background processes.
+
+#define IO_CLASS_REALTIME 1
+#define IO_CLASS_BEST_EFFORT 2
+#define IO_CLASS_IDLE 3
+#define IO_CLASS_SHIFT 13
+#define IO_PRIORITY_WHO_PROCESS 1
+#define DEFAULT_IO_PRIORITY_LEVEL 4
+// What the kernel's ioprio_set() system call takes (see <linux/ioprio.h>):
+// an I/O priority is a class shifted left by IO_CLASS_SHIFT plus a level
+// from 0 to 7, where 4 is the level a process gets by default.
+
+#ifndef USE_POSIX_SPAWN
+#define USE_POSIX_SPAWN TRUE
+#endif
+// Commands are started with posix_spawnp() unless this is FALSE, in which case
+// they are started with fork() and execvp(). (Compile with
+// -DUSE_POSIX_SPAWN=FALSE to get the fork() behavior.)
+
+extern char** environ;
+
+#ifndef USE_BUILT_INS
+#define USE_BUILT_INS TRUE
+#endif
+// Simple foreground commands like echo and test are run by the shell itself
+// (see struct builtIn) unless this is FALSE, in which case the programs with
+// those names are always run instead. (Compile with -DUSE_BUILT_INS=FALSE to
+// compare the two.)
+
+#define EXIT_COMMAND "exit"
+#define STATUS_COMMAND "status"
+#define CD_COMMAND "cd"
+// These are the three original built-in commands.
+#define TIME_COMMAND "time"
+// This built-in command runs a command and reports how long it took and what
+// resources it used (or, on its own, repeats the last such report).
+#define JOBS_COMMAND "jobs"
+// This built-in command lists the background processes that are running.
+#define HASH_COMMAND "hash"
+// This built-in command lists, clears, and fills the table of remembered
+// command locations (see struct commandHashTable).
+#define WAIT_COMMAND "wait"
+// This built-in command waits for background processes to finish.
+#define PARALLEL_COMMAND "parallel"
+// This built-in command runs a list of commands, a limited number at a time.
+#define MAX_PARALLEL_JOBS 4096
+// "parallel -j" can't keep more commands than this running at once (a
+// larger N is a usage error, rather than a huge allocation).
+#define MAX_PARALLEL_FAILURE_STATUS 101
+// After "parallel", "status" is the number of commands that failed, but no
+// more than this (the same convention as GNU parallel).
+#define JOBLOG_COMMAND "joblog"
+// This built-in command shows what a background process has output, when
+// that output is being captured (see struct jobLog).
+#define TIMEOUT_COMMAND "timeout"
+// This built-in command runs a command with a time limit.
+#define ON_COMMAND "on"
+#define PLACEMENT_COMMAND "placement"
+// These built-in commands choose where commands run and at what priority
+// (see struct placement): "on" for one command, and "placement" for every
+// foreground or background command.
+#define ADMIT_COMMAND "admit"
+// This built-in command sets when background commands have to wait their turn
+// (see struct admissionPolicy).
+#define TIMED_OUT_STATUS 124
+#define TIMEOUT_FAILURE_STATUS 125
+// After "timeout", "status" is 124 if the time ran out, or 125 if "timeout"
+// itself was used wrongly (the same convention as GNU timeout).
+
+#define DEFAULT_GRACE_PERIOD 2.0
+// When the shell exits, background processes get this many seconds to finish
+// after SIGTERM before they're killed (see prepForExit()), and so does a
+// command whose "timeout" has run out. The SMALLSH_GRACE_PERIOD environment
+// variable can change it.
+
+#define INITIAL_JOB_TABLE_CAPACITY 16 // Must be a power of 2.
+#define COMMAND_HASH_TABLE_SIZE 64 // Number of buckets; must be a power of 2.
+#define DEFAULT_PATH "/bin:/usr/bin" // What execvp() searches if PATH is unset.
+
+
+#define LOAD_AVERAGE_FILE "/proc/loadavg"
+#define CPU_PRESSURE_FILE "/proc/pressure/cpu"
+// Where admitBackgroundJob() reads how busy the system is.
+
+#define JOB_LOG_SIZE 65536
+// When background output is captured (smallsh -b), the last this many bytes
+// that each background job output are kept (see struct jobLog).
+#define MAX_FINISHED_JOB_LOGS 16
+// The logs of this many finished jobs are kept for "joblog", too; the oldest
+// is thrown away when another job finishes.
+#define JOB_LOG_EVENTS 16 // How many logs are read from per epoll_wait().
+
+struct jobLog // The captured output of one background job (smallsh -b).
+              // Everything the job writes to stdout or stderr goes into a
+              // pipe, and whenever the shell would otherwise sleep (at the
+              // prompt, or waiting for a process), it copies whatever is in
+              // the pipes into the jobs' logs. So the pipes never stay full
+              // for long, and the jobs never have to wait for us.
+{
+    pid_t processID;
+    char* commandLine;
+    int fd; // The read end of the pipe; -1 once every writer has closed it.
+    int finished; // Whether the job has been reaped.
+    long long totalBytes; // Everything the job has output, including what
+                          // has since been overwritten.
+    struct jobLog* next; // In the job table's list of finished jobs' logs.
+    char data[JOB_LOG_SIZE]; // A ring buffer: byte number N of the output
+                             // is at data[N % JOB_LOG_SIZE], so the newest
+                             // output overwrites the oldest.
+};
+
+struct placement // Where a command runs and at what priority. These are
+                 // set in the child, before it execs the command, so the
+                 // command starts out with them (and so do any threads or
+                 // processes it starts).
+{
+    int hasCPUs;
+    cpu_set_t cpus; // With sched_setaffinity().
+    int hasNiceness;
+    int niceness; // With setpriority(): -20 (most favored) to 19.
+    int hasIOPriority;
+    int ioPriority; // With ioprio_set(): a class and a level (see
+                    // parseIOPriority()).
+};
+
+struct placementSettings // The placement that each kind of command gets
+                         // unless "on" says otherwise.
+{
+    struct placement foreground; // Including the commands of "parallel".
+    struct placement background;
+};
+
+struct admissionPolicy // When a background command has to wait in the
+                       // queue before it starts (see admitBackgroundJob()).
+                       // 0 means no limit, for each of these.
+{
+    int maximumJobs; // Background jobs running at once.
+    double maximumLoad; // The 1-minute load average, from /proc/loadavg.
+    double maximumPressure; // The percentage of the last minute in which
+                            // some runnable task was waiting for a CPU, from
+                            // /proc/pressure/cpu ("some avg60").
+};
+
+struct queuedJob // A background command that is waiting in the queue.
+{
+    char** commandArray; // Its words (as expanded when it was typed), then
+                         // "&", then a NULL, all in the one allocation.
+    int arrayElementsUsed; // Including the "&".
+    double timeLimit; // For executeCommand() (see "timeout").
+    struct placement placement; // The background placement it was given.
+    struct timespec queueTime; // From CLOCK_MONOTONIC.
+    struct queuedJob* next;
+};
+
+struct job // Everything we keep track of for one background process.
+{
+    pid_t processID; // 0 means this slot of the job table is empty.
+    int jobNumber; // The number "jobs" shows in square brackets.
+    pid_t processGroup; // Every process in the job is in this group.
+    char* commandLine;
+    struct timespec startTime; // From CLOCK_MONOTONIC.
+    struct jobLog* log; // NULL unless its output is being captured.
+    long long deadline; // When the job's "timeout" runs out (a
+                        // CLOCK_MONOTONIC time in nanoseconds), or, once it
+                        // has, when it gets SIGKILL; 0 if there is none.
+    int timedOut; // Whether it has been sent SIGTERM because of that.
+};
+
+struct jobTable // Background processes, indexed by pid. This is a hash table
+                // with open addressing (linear probing), so adding, finding,
+                // and removing a job all take constant time on average, no
+                // matter how many jobs are running.
+{
+    struct job* slots;
+    int capacity; // Always a power of 2 (or 0 before the first job).
+    int count;
+    int nextJobNumber;
+    int logEpollFD; // Watches the pipes of every job log that is still open;
+                    // -1 unless background output is captured.
+    struct jobLog* finishedLogs; // Newest first.
+    int finishedLogCount;
+    int timerFD; // A timerfd that goes off at nextDeadline (see
+                 // enforceDeadlines()).
+    long long nextDeadline; // The earliest deadline of any job; 0 if none.
+    struct admissionPolicy admission; // Set with "admit".
+    struct queuedJob* queueHead; // The next one to start; NULL if none.
+    struct queuedJob* queueTail;
+    int queuedCount;
+
+    // What startQueuedJobs() needs to start a command whenever a job
+    // finishes (these point into the shell's struct smallshContext):
+    struct eventLoop* eventLoop;
+    struct sigaction* originalSigintAction;
+    struct commandHashTable* commandHashTable;
+    struct zygote* zygote;
+};
+
+struct resourceReport // What we measured about the last timed command.
+{
+    int available; // FALSE unless the last foreground command was timed.
+    struct timespec elapsed; // Wall-clock time, from CLOCK_MONOTONIC.
+    struct timeval userTime; // CPU time, added up over every stage of a
+    struct timeval systemTime; // pipeline.
+    long maxResidentKilobytes; // The largest of any one stage.
+    long voluntaryContextSwitches;
+    long involuntaryContextSwitches;
+};
+
+struct pipelineStage // One command in a pipeline ("cmd1 | cmd2 | ...").
+{
+    char** commandArray; // Ends with a NULL, so it can go straight to exec.
+    int arrayElementsUsed;
+    char* fileForInputRedirection; // NULL if there isn't any.
+    char* fileForOutputRedirection; // NULL if there isn't any.
+    char* textForInput; // From a here-string or here-document; NULL if
+                        // there isn't any.
+    int textNeedsNewline; // TRUE for a here-string.
+};
+
+struct parallelSlot // One of the commands that "parallel" has running.
+{
+    pid_t processID; // Of the last stage, for a pipeline; -1 if slot is free.
+    char* commandLine;
+};
+
+struct builtIn // A command that the shell runs itself, without starting a
+                // process. The function gets the command's words, like
+                // main() does, and returns its exit value.
+{
+    char* name;
+    int (*run)(char** commandArray, int arrayElementsUsed);
+};
+
+struct zygote // The helper process that starts commands in zygote mode.
+{
+    pid_t processID;
+    int socketFD; // Our end of the socket that requests go over; -1 if
+                  // there is no zygote.
+};
+
+struct zygoteRequest // What we send the zygote to start a command. It is
+                     // followed by "textLength" bytes of text: the path of
+                     // the executable and then "wordCount" words, each
+                     // ending in a \0. Up to five file descriptors come
+                     // along with it (in the order of the "has" fields).
+{
+    int actuallyRunInBackground;
+    pid_t processGroup;
+    int hasInputFD;
+    int hasOutputFD;
+    int hasErrorFD;
+    int hasDirectoryFD; // Our current directory, for the command to start in.
+    int hasTraceFD; // See openTracePipe().
+    int hasPlacement;
+    struct placement placement; // If hasPlacement is TRUE.
+    int wordCount;
+    size_t textLength;
+};
+
+struct zygoteReply // What the zygote sends back.
+{
+    pid_t processID; // Of the new process, or -1.
+    int error; // If processID is -1, the errno.
+};
+
+struct hashedCommand // One remembered command location, in a bucket's
+                     // linked list.
+{
+    char* name;
+    char* path;
+    int hits;
+    struct hashedCommand* next;
+};
+
+struct commandHashTable // Remembers where in PATH each command was found, so
+                        // that we don't have to search PATH every time.
+{
+    struct hashedCommand* buckets[COMMAND_HASH_TABLE_SIZE];
+    char* pathVariable; // The value of PATH when the entries were found.
+    char* uncachedPath; // The last path found that we couldn't remember.
+};
+
+struct inputReader // Where commands come from: stdin, a script file, or the
+                   // string given with "-c".
+{
+    int fd; // -1 when reading from a string.
+    char* buffer;
+    size_t capacity; // The buffer has room for one more byte than this.
+    size_t start; // Where the input that hasn't been used yet starts...
+    size_t end; // ...and ends.
+    int atEndOfFile;
+    int interactive; // Whether to output prompts.
+};
+
+struct commandTrace // In trace mode (see writeTrace()), when each phase of
+                    // running a command ended. Times are CLOCK_MONOTONIC
+                    // nanoseconds, and 0 means the phase didn't happen.
+{
+    int fd; // Where the trace goes; -1 if trace mode is off.
+    char* commandLine;
+    long long readTime; // The line was read.
+    long long tokenizeTime; // It was split into words.
+    long long expandTime; // "$$" and wildcards were expanded.
+    long long forkTime; // We started to start the first process.
+    long long execTime; // The last process was about to exec.
+    long long waitTime; // We first woke up from waiting for a process.
+    long long exitTime; // The last process had been reaped.
+    pid_t processID; // Of the last process in the pipeline.
+    int stageCount;
+    int builtIn;
+    int background;
+    int exitValue; // -1 unless the command exited...
+    int signal; // ...or -1 unless it was killed by a signal.
+};
+
+struct eventLoop // What the shell waits on. Rather than having signal
+                 // handlers, the shell blocks SIGCHLD, SIGTSTP, and SIGINT
+                 // and reads them from a signalfd, which is watched with
+                 // epoll along with the input. Signals that arrive while
+                 // we're busy just wait in the signalfd (and in the flags
+                 // below) until we're ready for them.
+{
+    int epollFD;
+    int signalFD;
+    int watchingInput; // Whether the input's fd is in the epoll set. (Regular
+                       // files can't be, but they never make us wait.)
+    int sigchldArrived;
+    int sigtstpArrived;
+    int sigintArrived;
+};
+
+struct arenaBlock // One chunk of memory handed out by a wordArena.
+{
+    struct arenaBlock* next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+struct commandListItem // One command in a list ("cmd1 ; cmd2 && cmd3").
+{
+    char** commandArray; // NULL-terminated.
+    int arrayElementsUsed;
+    int condition; // RUN_ALWAYS, RUN_IF_SUCCEEDED, or RUN_IF_FAILED.
+};
+
+struct wordList // The words of a line (see splitIntoWords()).
+{
+    char** words; // NULL-terminated, so it can be handed to execv().
+    int capacity; // How many words (not counting the NULL) fit.
+};
+
+struct globMatches // The file names that a pattern matched so far.
+{
+    char** names;
+    int count;
+    int capacity;
+    char* buffer; // Where getdents64() puts directory entries.
+};
+
+struct directoryEntry // What getdents64() fills its buffer with (struct
+                      // linux_dirent64 in the man page).
+{
+    unsigned long long inode;
+    long long offset;
+    unsigned short recordLength;
+    unsigned char type;
+    char name[];
+};
+
+struct wordArena // Hands out memory for words that can't stay in the line
+                 // buffer. Everything it hands out is released at once, by
+                 // resetArena(), before the next prompt.
+{
+    struct arenaBlock* first;
+    struct arenaBlock* current;
+};
+
+// The next two functions will be used throughout the rest of the program
+// to safely generate output:
+
+static void outputStringWithNoNewline(char* text)
+{
+    printf("%s", text);
+    fflush(stdout);
+}
+
+static void outputStringWithANewline(char* text)
+{
+    printf("%s\n", text);
+    fflush(stdout);
+}
+
+// This function returns the time, from CLOCK_MONOTONIC, in nanoseconds:
+static long long monotonicNanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// This function returns TRUE if "trace" (which may be NULL) is to be filled
+// in. When trace mode is off, that is all the time it costs.
+static int tracing(struct commandTrace* trace)
+{
+    return trace != NULL && trace->fd != -1;
+}
+
+// This function clears out "trace" for the next command:
+static void startTrace(struct commandTrace* trace)
+{
+    int fd = trace->fd;
+
+    memset(trace, 0, sizeof(*trace));
+    trace->fd = fd;
+    trace->exitValue = -1;
+    trace->signal = -1;
+
+    return;
+}
+
+// This function clears out the parts of "trace" that belong to one command,
+// for the next command on the same line. The times that the line was read,
+// split, and expanded belong to all of its commands, so they are kept.
+static void restartTrace(struct commandTrace* trace)
+{
+    long long readTime = trace->readTime;
+    long long tokenizeTime = trace->tokenizeTime;
+    long long expandTime = trace->expandTime;
+
+    startTrace(trace);
+    trace->readTime = readTime;
+    trace->tokenizeTime = tokenizeTime;
+    trace->expandTime = expandTime;
+
+    return;
+}
+
+// This function writes all of "data" to a file descriptor. Returns FALSE if
+// it couldn't.
+static int writeAll(int fd, char* data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return FALSE;
+        }
+        data += written;
+        length -= written;
+    }
+
+    return TRUE;
+}
+
+// This function outputs one field of a trace: a time, or null if it's 0.
+static void outputTraceTime(FILE* line, char* name, long long time)
+{
+    if (time == 0)
+    {
+        fprintf(line, ",\"%s\":null", name);
+    }
+    else
+    {
+        fprintf(line, ",\"%s\":%lld", name, time);
+    }
+
+    return;
+}
+
+// This function implements trace mode. If the SMALLSH_TRACE_FD environment
+// variable is set to a file descriptor number, then for every command that
+// executeCommand() runs, one line of JSON is written to that file
+// descriptor. For example:
+//   {"command":"ls -l","pid":1234,"stages":1,"builtin":false,
+//    "background":false,"read_ns":...,"tokenize_ns":...,"expand_ns":...,
+//    "fork_ns":...,"exec_ns":...,"wait_ns":...,"exit_ns":...,
+//    "exit_value":0,"signal":null}
+// (all on one line). The times are CLOCK_MONOTONIC nanoseconds; see struct
+// commandTrace for what each one means. The line is written with a single
+// write() if possible, so lines don't get mixed up even if other programs
+// write to the same file. (A pipe only promises that for up to PIPE_BUF
+// bytes; if a long line is written in pieces, the rest of it is written
+// right away.) If the trace can't be written, tracing is turned off.
+static void writeTrace(struct commandTrace* trace)
+{
+    if (tracing(trace) == FALSE)
+    {
+        return;
+    }
+
+    char* text = NULL;
+    size_t length = 0;
+    FILE* line = open_memstream(&text, &length);
+    if (line == NULL)
+    {
+        free(trace->commandLine);
+        trace->commandLine = NULL;
+        return;
+    }
+
+    // The command, with the characters that JSON doesn't allow in a string
+    // escaped. Bytes past ASCII are escaped, too, since a file name (and so
+    // a command) needn't be valid UTF-8, but JSON must be:
+    fputs("{\"command\":\"", line);
+    char* next;
+    for (next = trace->commandLine; next != NULL && *next != 0; next++)
+    {
+        if (*next == '"' || *next == '\\')
+        {
+            fprintf(line, "\\%c", *next);
+        }
+        else if ((unsigned char) *next < 0x20 || (unsigned char) *next >= 0x80)
+        {
+            fprintf(line, "\\u%04x", (unsigned char) *next);
+        }
+        else
+        {
+            fputc(*next, line);
+        }
+    }
+    fputc('"', line);
+
+    fprintf(line, ",\"pid\":%d,\"stages\":%d,\"builtin\":%s,"
+            "\"background\":%s", (int) trace->processID, trace->stageCount,
+            (trace->builtIn == TRUE) ? "true" : "false",
+            (trace->background == TRUE) ? "true" : "false");
+
+    outputTraceTime(line, "read_ns", trace->readTime);
+    outputTraceTime(line, "tokenize_ns", trace->tokenizeTime);
+    outputTraceTime(line, "expand_ns", trace->expandTime);
+    outputTraceTime(line, "fork_ns", trace->forkTime);
+    outputTraceTime(line, "exec_ns", trace->execTime);
+    outputTraceTime(line, "wait_ns", trace->waitTime);
+    outputTraceTime(line, "exit_ns", trace->exitTime);
+
+    if (trace->exitValue == -1)
+    {
+        fputs(",\"exit_value\":null", line);
+    }
+    else
+    {
+        fprintf(line, ",\"exit_value\":%d", trace->exitValue);
+    }
+    if (trace->signal == -1)
+    {
+        fputs(",\"signal\":null}\n", line);
+    }
+    else
+    {
+        fprintf(line, ",\"signal\":%d}\n", trace->signal);
+    }
+
+    fclose(line);
+
+    // If whatever was reading the trace has gone away, the write gets SIGPIPE,
+    // which would end the shell. So SIGPIPE is blocked while we write, and
+    // one that we caused is taken back off of the list of pending signals:
+    sigset_t pipeSignal;
+    sigset_t originalMask;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    sigprocmask(SIG_BLOCK, &pipeSignal, &originalMask);
+
+    if (writeAll(trace->fd, text, length) == FALSE)
+    {
+        if (errno == EPIPE)
+        {
+            struct timespec noWaiting = {0, 0};
+            sigtimedwait(&pipeSignal, NULL, &noWaiting);
+        }
+        perror("Error when writing a trace! Not tracing any more");
+        trace->fd = -1;
+    }
+
+    sigprocmask(SIG_SETMASK, &originalMask, NULL);
+    free(text);
+
+    free(trace->commandLine);
+    trace->commandLine = NULL;
+
+    return;
+}
+
+// This function toggles our state between the normal mode and the foreground-
+// only mode:
+static void implementSigtstpLogic(int* usingBackgroundIsPossible)
+{
+    if (*usingBackgroundIsPossible == TRUE)
+    {
+        *usingBackgroundIsPossible = FALSE;
+        char* message =
+            "\nEntering foreground-only mode (& is now ignored)\n";
+        write(STDOUT_FILENO, message, 50);
+    }
+    else
+    {
+        *usingBackgroundIsPossible = TRUE;
+        char* message = "\nExiting foreground-only mode\n";
+        write(STDOUT_FILENO, message, 30);
+    }
+}
+
+// This function returns how long background processes get to finish after
+// SIGTERM, when the shell exits (see prepForExit()) or their time runs out
+// (see enforceDeadlines()), in seconds: SMALLSH_GRACE_PERIOD, if that's set
+// to a number, and otherwise DEFAULT_GRACE_PERIOD.
+static double gracePeriod()
+{
+    char* variable = getenv("SMALLSH_GRACE_PERIOD");
+
+    if (variable != NULL && variable[0] != 0)
+    {
+        char* end;
+        double seconds = strtod(variable, &end);
+        if (*end == 0 && seconds >= 0)
+        {
+            return seconds;
+        }
+    }
+
+    return DEFAULT_GRACE_PERIOD;
+}
+
+// This function gives a background job a deadline (see struct job), setting
+// the timer to go off then if that's earlier than it would already.
+static void setJobDeadline
+(
+    struct jobTable* jobTable,
+    struct job* job,
+    long long deadline
+)
+{
+    job->deadline = deadline;
+
+    if (jobTable->nextDeadline == 0 || deadline < jobTable->nextDeadline)
+    {
+        struct itimerspec timer = {{0}};
+        timer.it_value.tv_sec = deadline / 1000000000LL;
+        timer.it_value.tv_nsec = deadline % 1000000000LL;
+        timerfd_settime(jobTable->timerFD, TFD_TIMER_ABSTIME, &timer, NULL);
+        jobTable->nextDeadline = deadline;
+    }
+
+    return;
+}
+
+// This function is called when the deadline timer goes off. Every job whose
+// time has run out gets SIGTERM (and SIGCONT, in case it's stopped), sent to
+// its process group so that every stage of a pipeline gets it, and then
+// gracePeriod() seconds to finish before it gets SIGKILL. However many jobs
+// have deadlines, the shell only has the one timer to watch: it is set again
+// for the earliest deadline that is left.
+static void enforceDeadlines(struct jobTable* jobTable)
+{
+    unsigned long long expirations;
+    read(jobTable->timerFD, &expirations, sizeof(expirations));
+
+    long long now = monotonicNanoseconds();
+    long long graceNanoseconds = (long long)(gracePeriod() * 1000000000.0);
+    int i;
+
+    jobTable->nextDeadline = 0;
+
+    for (i = 0; i < jobTable->capacity; i++)
+    {
+        struct job* job = &jobTable->slots[i];
+
+        if (job->processID == 0 || job->deadline == 0)
+        {
+            continue;
+        }
+
+        if (job->deadline <= now && job->timedOut == FALSE)
+        {
+            kill(-job->processGroup, SIGTERM);
+            kill(-job->processGroup, SIGCONT);
+            job->timedOut = TRUE;
+            job->deadline = now + graceNanoseconds;
+        }
+        else if (job->deadline <= now)
+        {
+            kill(-job->processGroup, SIGKILL);
+            job->deadline = 0;
+            continue;
+        }
+
+        if (jobTable->nextDeadline == 0 ||
+            job->deadline < jobTable->nextDeadline)
+        {
+            jobTable->nextDeadline = job->deadline;
+        }
+    }
+
+    // (An all-zero time turns the timer off.)
+    struct itimerspec timer = {{0}};
+    timer.it_value.tv_sec = jobTable->nextDeadline / 1000000000LL;
+    timer.it_value.tv_nsec = jobTable->nextDeadline % 1000000000LL;
+    timerfd_settime(jobTable->timerFD, TFD_TIMER_ABSTIME, &timer, NULL);
+
+    return;
+}
+
+// This function makes a log for a background job that is about to start (if
+// background output is captured), and puts the write end of its pipe in
+// *writeFD for the job's stdout and stderr. The read end is non-blocking, so
+// that reading from it never makes the shell wait. Returns NULL (with
+// *writeFD set to -1) if output isn't captured or the pipe can't be made.
+static struct jobLog* openJobLog(struct jobTable* jobTable, int* writeFD)
+{
+    int pipeEnds[2];
+
+    *writeFD = -1;
+
+    if (jobTable->logEpollFD == -1)
+    {
+        return NULL;
+    }
+
+    if (pipe2(pipeEnds, O_CLOEXEC) == -1)
+    {
+        perror("Error when creating a pipe for a background job's output!");
+        return NULL;
+    }
+
+    struct jobLog* log = malloc(sizeof(struct jobLog));
+    if (log == NULL)
+    {
+        perror("Error when allocating memory for a job log!");
+        exit(1);
+    }
+
+    fcntl(pipeEnds[0], F_SETFL, O_NONBLOCK);
+
+    log->processID = -1;
+    log->commandLine = NULL;
+    log->fd = pipeEnds[0];
+    log->finished = FALSE;
+    log->totalBytes = 0;
+    log->next = NULL;
+
+    *writeFD = pipeEnds[1];
+
+    return log;
+}
+
+// This function starts watching a log's pipe, once its job has started:
+static void watchJobLog(struct jobTable* jobTable, struct jobLog* log)
+{
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.ptr = log;
+    epoll_ctl(jobTable->logEpollFD, EPOLL_CTL_ADD, log->fd, &event);
+
+    return;
+}
+
+// This function stops reading a log's pipe. (We remove the pipe from the
+// epoll set ourselves rather than counting on close() to do it: that only
+// happens once every copy of the file descriptor is closed, and a child that
+// is between fork() and exec() may still have one.)
+static void closeJobLogPipe(struct jobTable* jobTable, struct jobLog* log)
+{
+    if (log->fd != -1)
+    {
+        epoll_ctl(jobTable->logEpollFD, EPOLL_CTL_DEL, log->fd, NULL);
+        close(log->fd);
+        log->fd = -1;
+    }
+
+    return;
+}
+
+// This function copies everything that is waiting in a log's pipe into the
+// log, without waiting for more. The pipe is closed once the job (and
+// anything else that had the write end) has closed it.
+static void readJobLog(struct jobTable* jobTable, struct jobLog* log)
+{
+    while (log->fd != -1)
+    {
+        size_t position = log->totalBytes % JOB_LOG_SIZE;
+        ssize_t bytesRead =
+            read(log->fd, log->data + position, JOB_LOG_SIZE - position);
+
+        if (bytesRead > 0)
+        {
+            log->totalBytes += bytesRead;
+        }
+        else if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (bytesRead == -1 && errno == EAGAIN)
+        {
+            break; // The pipe is empty for now.
+        }
+        else
+        {
+            closeJobLogPipe(jobTable, log);
+        }
+    }
+
+    return;
+}
+
+// This function reads from every log whose pipe has something in it. It
+// never waits, so it costs one epoll_wait() when there's nothing to read, no
+// matter how many jobs are running.
+static void readJobLogs(struct jobTable* jobTable)
+{
+    struct epoll_event events[JOB_LOG_EVENTS];
+    int eventCount;
+
+    if (jobTable->logEpollFD == -1)
+    {
+        return;
+    }
+
+    do
+    {
+        eventCount = epoll_wait(jobTable->logEpollFD, events, JOB_LOG_EVENTS,
+                                0);
+
+        int i;
+        for (i = 0; i < eventCount; i++)
+        {
+            readJobLog(jobTable, events[i].data.ptr);
+        }
+    } while (eventCount == JOB_LOG_EVENTS);
+
+    return;
+}
+
+// This function gives back everything a log used:
+static void freeJobLog(struct jobTable* jobTable, struct jobLog* log)
+{
+    closeJobLogPipe(jobTable, log);
+    free(log->commandLine);
+    free(log);
+
+    return;
+}
+
+// This function moves the log of a job that has been reaped to the list of
+// finished jobs' logs, throwing away the oldest one if there are too many.
+// Whatever the job output last is read first. (Its pipe stays open until
+// every writer has closed it, in case the job left a process of its own
+// running.)
+static void finishJobLog(struct jobTable* jobTable, struct jobLog* log)
+{
+    readJobLog(jobTable, log);
+    log->finished = TRUE;
+
+    log->next = jobTable->finishedLogs;
+    jobTable->finishedLogs = log;
+    jobTable->finishedLogCount++;
+
+    if (jobTable->finishedLogCount > MAX_FINISHED_JOB_LOGS)
+    {
+        struct jobLog* secondToLast = jobTable->finishedLogs;
+        while (secondToLast->next->next != NULL)
+        {
+            secondToLast = secondToLast->next;
+        }
+        freeJobLog(jobTable, secondToLast->next);
+        secondToLast->next = NULL;
+        jobTable->finishedLogCount--;
+    }
+
+    return;
+}
+
+// This function computes the slot of the job table that the given pid would
+// be in, if nothing else were already there. (Multiplying by this large odd
+// number is Knuth's "multiplicative hashing"; it spreads out pids that are
+// close together.)
+static int homeSlotForJob(pid_t processID, int capacity)
+{
+    return (int)(((unsigned int)processID * 2654435761u) & (capacity - 1));
+}
+
+// This function returns the job for the given pid, or NULL if there isn't
+// one:
+static struct job* findJob(struct jobTable* jobTable, pid_t processID)
+{
+    if (jobTable->count == 0)
+    {
+        return NULL;
+    }
+
+    int slot = homeSlotForJob(processID, jobTable->capacity);
+
+    // Starting at the job's home slot, look at each slot in turn until we
+    // find the job or an empty slot (which means the job isn't here):
+    while (jobTable->slots[slot].processID != 0)
+    {
+        if (jobTable->slots[slot].processID == processID)
+        {
+            return &jobTable->slots[slot];
+        }
+        slot = (slot + 1) & (jobTable->capacity - 1);
+    }
+
+    return NULL;
+}
+
+// This function puts a job (which must not be in the table already) into the
+// first empty slot at or after its home slot. The table must have room.
+static struct job* placeJob(struct jobTable* jobTable, struct job* newJob)
+{
+    int slot = homeSlotForJob(newJob->processID, jobTable->capacity);
+
+    while (jobTable->slots[slot].processID != 0)
+    {
+        slot = (slot + 1) & (jobTable->capacity - 1);
+    }
+
+    jobTable->slots[slot] = *newJob;
+
+    return &jobTable->slots[slot];
+}
+
+// This function adds a background process to the job table. commandLine is
+// copied. Returns the new job.
+static struct job* rememberJob
+(
+    struct jobTable* jobTable,
+    pid_t processID,
+    char* commandLine
+)
+{
+    // Keep the table at most half full, so that the runs of occupied slots
+    // we have to look through stay short. When it would get fuller than that,
+    // we move everything into a table twice the size:
+    if ((jobTable->count + 1) * 2 > jobTable->capacity)
+    {
+        struct job* oldSlots = jobTable->slots;
+        int oldCapacity = jobTable->capacity;
+
+        jobTable->capacity =
+            (oldCapacity == 0) ? INITIAL_JOB_TABLE_CAPACITY : oldCapacity * 2;
+        jobTable->slots = calloc(jobTable->capacity, sizeof(struct job));
+        if (jobTable->slots == NULL)
+        {
+            perror("Error when allocating memory for the job table!");
+            exit(1);
+        }
+
+        int i;
+        for (i = 0; i < oldCapacity; i++)
+        {
+            if (oldSlots[i].processID != 0)
+            {
+                placeJob(jobTable, &oldSlots[i]);
+            }
+        }
+
+        free(oldSlots);
+    }
+
+    if (jobTable->count == 0)
+    {
+        // Start numbering over whenever there are no jobs left.
+        jobTable->nextJobNumber = 1;
+    }
+
+    struct job newJob;
+    newJob.processID = processID;
+    newJob.jobNumber = jobTable->nextJobNumber;
+    newJob.processGroup = processID;
+    newJob.commandLine = strdup(commandLine);
+    clock_gettime(CLOCK_MONOTONIC, &newJob.startTime);
+    newJob.log = NULL;
+    newJob.deadline = 0;
+    newJob.timedOut = FALSE;
+
+    jobTable->nextJobNumber++;
+    jobTable->count++;
+
+    return placeJob(jobTable, &newJob);
+}
+
+// This function removes the given pid from the job table. Returns FALSE if
+// the pid wasn't there.
+static int forgetJob(struct jobTable* jobTable, pid_t processID)
+{
+    struct job* found = findJob(jobTable, processID);
+
+    if (found == NULL)
+    {
+        return FALSE;
+    }
+
+    free(found->commandLine);
+    if (found->log != NULL)
+    {
+        finishJobLog(jobTable, found->log);
+    }
+
+    int mask = jobTable->capacity - 1;
+    int hole = found - jobTable->slots;
+    int slot = hole;
+
+    // We can't just empty the slot: a job further along might have been put
+    // after this one only because this slot was taken, and findJob() would
+    // stop looking at the hole before reaching it. So we pull any such jobs
+    // back into the hole ("backward shift deletion"):
+    while (TRUE)
+    {
+        slot = (slot + 1) & mask;
+
+        if (jobTable->slots[slot].processID == 0)
+        {
+            break;
+        }
+
+        int home = homeSlotForJob(jobTable->slots[slot].processID,
+                                  jobTable->capacity);
+
+        // The job in "slot" can move back into the hole unless its home
+        // slot lies after the hole (going around the table the same way we
+        // look through it):
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            jobTable->slots[hole] = jobTable->slots[slot];
+            hole = slot;
+        }
+    }
+
+    jobTable->slots[hole].processID = 0;
+    jobTable->count--;
+
+    return TRUE;
+}
+
+// This function compares two jobs by job number, for qsort():
+static int compareJobNumbers(const void* first, const void* second)
+{
+    const struct job* firstJob = *(const struct job* const*)first;
+    const struct job* secondJob = *(const struct job* const*)second;
+
+    return firstJob->jobNumber - secondJob->jobNumber;
+}
+
+// This function returns a newly allocated array of pointers to every job in
+// the table, in the order the jobs were started. The caller must free() the
+// array (but not the jobs), and must not use it after the table changes.
+static struct job** listJobsInOrder(struct jobTable* jobTable)
+{
+    struct job** jobs = malloc((jobTable->count + 1) * sizeof(struct job*));
+    if (jobs == NULL)
+    {
+        perror("Error when allocating memory for the job list!");
+        exit(1);
+    }
+
+    int found = 0;
+    int i;
+
+    for (i = 0; i < jobTable->capacity; i++)
+    {
+        if (jobTable->slots[i].processID != 0)
+        {
+            jobs[found] = &jobTable->slots[i];
+            found++;
+        }
+    }
+
+    qsort(jobs, found, sizeof(struct job*), compareJobNumbers);
+
+    return jobs;
+}
+
+// This function implements the "jobs" built-in command. Every job in the table
+// is running (a job is removed as soon as it is reaped). Queued commands (see
+// queueBackgroundJob()) are listed after the running ones, as "[qN]", where N
+// is the command's place in the queue.
+static void outputJobs(struct jobTable* jobTable)
+{
+    struct job** jobs = listJobsInOrder(jobTable);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int i;
+    for (i = 0; i < jobTable->count; i++)
+    {
+        printf
+        (
+            "[%d] %d Running %lds %s\n",
+            jobs[i]->jobNumber,
+            jobs[i]->processID,
+            (long)(now.tv_sec - jobs[i]->startTime.tv_sec),
+            jobs[i]->commandLine
+        );
+    }
+
+    // Then the commands that are waiting to start, next one first:
+    struct queuedJob* queued;
+    int position = 1;
+    for (queued = jobTable->queueHead; queued != NULL; queued = queued->next)
+    {
+        printf
+        (
+            "[q%d] - Queued %lds",
+            position,
+            (long)(now.tv_sec - queued->queueTime.tv_sec)
+        );
+        for (i = 0; i < queued->arrayElementsUsed; i++)
+        {
+            printf(" %s", queued->commandArray[i]);
+        }
+        printf("\n");
+        position++;
+    }
+    fflush(stdout);
+
+    free(jobs);
+
+    return;
+}
+
+// This function reads one number from a small file in /proc: the one right
+// after "label" (or, if label is NULL, the first one). Returns -1 if there's
+// no such file or number (/proc/pressure, for example, is new in Linux 4.20).
+static double readProcNumber(char* fileName, char* label)
+{
+    char buffer[256];
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    ssize_t bytesRead = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (bytesRead <= 0)
+    {
+        return -1;
+    }
+    buffer[bytesRead] = 0;
+
+    char* number = buffer;
+    if (label != NULL)
+    {
+        number = strstr(buffer, label);
+        if (number == NULL)
+        {
+            return -1;
+        }
+        number += strlen(label);
+    }
+
+    char* end;
+    double value = strtod(number, &end);
+
+    return (end == number) ? -1 : value;
+}
+
+// This function decides whether a new background job may start now, under
+// the job table's admission policy (see struct admissionPolicy): it may if
+// fewer than maximumJobs jobs are running, and the load average and CPU
+// pressure are no more than their maximums. (Those are only read from /proc
+// if they have limits.) If none of our jobs are running, though, the answer
+// is always yes. Then the load is coming from somewhere else, and waiting
+// for it to go away could take forever; this way our jobs at least run one at
+// a time, and the queue only ever waits for one of our own jobs to finish.
+static int admitBackgroundJob(struct jobTable* jobTable)
+{
+    struct admissionPolicy* policy = &jobTable->admission;
+
+    if (jobTable->count == 0)
+    {
+        return TRUE;
+    }
+
+    if (policy->maximumJobs > 0 && jobTable->count >= policy->maximumJobs)
+    {
+        return FALSE;
+    }
+
+    if (policy->maximumLoad > 0 &&
+        readProcNumber(LOAD_AVERAGE_FILE, NULL) > policy->maximumLoad)
+    {
+        return FALSE;
+    }
+
+    if (policy->maximumPressure > 0 &&
+        readProcNumber(CPU_PRESSURE_FILE, "avg60=") > policy->maximumPressure)
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// This function puts a background command at the end of the queue, to be
+// started by startQueuedJobs(). commandArray (which must end with "&") is
+// copied, words and all, since the originals only last until the next line.
+static void queueBackgroundJob
+(
+    struct jobTable* jobTable,
+    char** commandArray,
+    int arrayElementsUsed,
+    double timeLimit,
+    struct placement* placement
+)
+{
+    size_t size = (arrayElementsUsed + 1) * sizeof(char*);
+    int i;
+
+    for (i = 0; i < arrayElementsUsed; i++)
+    {
+        size += strlen(commandArray[i]) + 1;
+    }
+
+    struct queuedJob* job = malloc(sizeof(struct queuedJob));
+    char** copy = malloc(size);
+    if (job == NULL || copy == NULL)
+    {
+        perror("Error when allocating memory for a queued command!");
+        exit(1);
+    }
+
+    // The words go right after the array of pointers to them:
+    char* next = (char*)(copy + arrayElementsUsed + 1);
+    for (i = 0; i < arrayElementsUsed; i++)
+    {
+        copy[i] = next;
+        next = stpcpy(next, commandArray[i]) + 1;
+    }
+    copy[arrayElementsUsed] = NULL;
+
+    job->commandArray = copy;
+    job->arrayElementsUsed = arrayElementsUsed;
+    job->timeLimit = timeLimit;
+    job->placement = *placement;
+    clock_gettime(CLOCK_MONOTONIC, &job->queueTime);
+    job->next = NULL;
+
+    if (jobTable->queueTail == NULL)
+    {
+        jobTable->queueHead = job;
+    }
+    else
+    {
+        jobTable->queueTail->next = job;
+    }
+    jobTable->queueTail = job;
+    jobTable->queuedCount++;
+
+    char queuedMessage[STATUS_REPORT_MAX_LENGTH];
+    sprintf(queuedMessage, "background command is queued (%d ahead of it)",
+            jobTable->queuedCount - 1);
+    outputStringWithANewline(queuedMessage);
+
+    return;
+}
+
+// This function takes the first command off of the queue and returns it
+// (NULL if the queue is empty). The caller must free it with
+// freeQueuedJob().
+static struct queuedJob* dequeueBackgroundJob(struct jobTable* jobTable)
+{
+    struct queuedJob* job = jobTable->queueHead;
+
+    if (job != NULL)
+    {
+        jobTable->queueHead = job->next;
+        if (jobTable->queueHead == NULL)
+        {
+            jobTable->queueTail = NULL;
+        }
+        jobTable->queuedCount--;
+    }
+
+    return job;
+}
+
+// This function gives back a queued command's memory:
+static void freeQueuedJob(struct queuedJob* job)
+{
+    free(job->commandArray);
+    free(job);
+
+    return;
+}
+
+// This function throws away every command that is still in the queue (when
+// the shell exits). Returns how many there were.
+static int discardQueuedJobs(struct jobTable* jobTable)
+{
+    int discarded = jobTable->queuedCount;
+    struct queuedJob* job;
+
+    while ((job = dequeueBackgroundJob(jobTable)) != NULL)
+    {
+        freeQueuedJob(job);
+    }
+
+    return discarded;
+}
+
+// This function finds the log of the given background process, whether it
+// is still running or not. Returns NULL if there isn't one.
+static struct jobLog* findJobLog(struct jobTable* jobTable, pid_t processID)
+{
+    struct job* job = findJob(jobTable, processID);
+
+    if (job != NULL)
+    {
+        return job->log;
+    }
+
+    struct jobLog* log;
+    for (log = jobTable->finishedLogs; log != NULL; log = log->next)
+    {
+        if (log->processID == processID)
+        {
+            return log;
+        }
+    }
+
+    return NULL;
+}
+
+// This function outputs one line about a log, for "joblog" on its own:
+static void outputJobLogSummary(struct jobLog* log)
+{
+    printf
+    (
+        "%d %s %lld bytes %s\n",
+        log->processID,
+        (log->finished == TRUE) ? "Done" : "Running",
+        log->totalBytes,
+        log->commandLine
+    );
+
+    return;
+}
+
+// This function implements the "joblog" built-in command:
+//   joblog         lists the background processes whose output was captured
+//                  (the running ones, and then the most recently finished)
+//   joblog PID     outputs what that process has output (the last
+//                  JOB_LOG_SIZE bytes of it)
+// For "status", the result is 1 if output isn't being captured or PID has no
+// log, and 0 otherwise.
+static void jobLogBuiltIn
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct jobTable* jobTable,
+    int* statusType,
+    int* statusValue
+)
+{
+    *statusType = EXIT_VALUE;
+    *statusValue = 1;
+
+    if (jobTable->logEpollFD == -1)
+    {
+        fprintf(stderr, "joblog: background output isn't being captured "
+                "(see smallsh -b)\n");
+        return;
+    }
+
+    // Bring every log up to date first:
+    readJobLogs(jobTable);
+
+    int i;
+
+    if (arrayElementsUsed == 1)
+    {
+        struct job** jobs = listJobsInOrder(jobTable);
+        for (i = 0; i < jobTable->count; i++)
+        {
+            if (jobs[i]->log != NULL)
+            {
+                outputJobLogSummary(jobs[i]->log);
+            }
+        }
+        free(jobs);
+
+        struct jobLog* log;
+        for (log = jobTable->finishedLogs; log != NULL; log = log->next)
+        {
+            outputJobLogSummary(log);
+        }
+        fflush(stdout);
+
+        *statusValue = 0;
+        return;
+    }
+
+    char* end;
+    long processID = strtol(commandArray[1], &end, 10);
+    struct jobLog* log = NULL;
+    if (*end == 0 && end != commandArray[1] && processID > 0)
+    {
+        log = findJobLog(jobTable, processID);
+    }
+
+    if (log == NULL)
+    {
+        fprintf(stderr, "joblog: %s: no output was captured for that "
+                "process\n", commandArray[1]);
+        return;
+    }
+
+    if (log->totalBytes <= JOB_LOG_SIZE)
+    {
+        fwrite(log->data, 1, log->totalBytes, stdout);
+    }
+    else
+    {
+        // The ring buffer has wrapped around, so the oldest byte we still
+        // have is the one that the next byte of output would overwrite:
+        size_t position = log->totalBytes % JOB_LOG_SIZE;
+
+        fprintf(stderr, "joblog: (the first %lld bytes weren't kept)\n",
+                log->totalBytes - JOB_LOG_SIZE);
+        fwrite(log->data + position, 1, JOB_LOG_SIZE - position, stdout);
+        fwrite(log->data, 1, position, stdout);
+    }
+    fflush(stdout);
+
+    *statusValue = 0;
+
+    return;
+}
+
+// This function reports how a background process ended and removes that pid
+// from the job table. (Any queued command that there's now room for is
+// started later, by whoever called this; see startQueuedJobs().) Children
+// that aren't on the list (for example, foreground processes that were
+// already waited for) are quietly ignored. If startOnNewLine is TRUE, the
+// report is moved off of the line that the prompt is on. Returns TRUE if a
+// report was output.
+static int reportFinishedBackgroundProcess
+(
+    int processID,
+    int childExitMethod,
+    struct jobTable* jobTable,
+    int startOnNewLine
+)
+{
+    int statusValue = -5;
+    char statusReport[STATUS_REPORT_MAX_LENGTH];
+    struct job* job = findJob(jobTable, processID);
+
+    if (job == NULL)
+    {
+        return FALSE;
+    }
+
+    if (WIFEXITED(childExitMethod) != 0)
+    {
+        // The process exited by exit(0), exit(1), return 0, etc.
+        statusValue = WEXITSTATUS(childExitMethod);
+        sprintf
+        (
+            statusReport,
+            "background pid %d is done: exit value %d",
+            processID,
+            statusValue
+        );
+    }
+    else
+    {
+        // The process exited because of an uncaught signal.
+        statusValue = WTERMSIG(childExitMethod);
+        sprintf
+        (
+            statusReport,
+            "background pid %d is done: terminated by signal %d",
+            processID,
+            statusValue
+        );
+    }
+
+    if (job->timedOut == TRUE)
+    {
+        strcat(statusReport, " (timed out)");
+    }
+
+    if (startOnNewLine == TRUE)
+    {
+        outputStringWithNoNewline("\n");
+    }
+    outputStringWithANewline(statusReport);
+    forgetJob(jobTable, processID);
+
+    return TRUE;
+}
+
+// This function reads every signal that has arrived on the signalfd since the
+// last time it was called, and notes which ones they were. (The signalfd is
+// non-blocking, so this never waits.)
+static void readSignals(struct eventLoop* eventLoop)
+{
+    struct signalfd_siginfo signalInfo;
+
+    while (read(eventLoop->signalFD, &signalInfo, sizeof(signalInfo)) ==
+           sizeof(signalInfo))
+    {
+        if (signalInfo.ssi_signo == SIGCHLD)
+        {
+            eventLoop->sigchldArrived = TRUE;
+        }
+        else if (signalInfo.ssi_signo == SIGTSTP)
+        {
+            eventLoop->sigtstpArrived = TRUE;
+        }
+        else if (signalInfo.ssi_signo == SIGINT)
+        {
+            eventLoop->sigintArrived = TRUE;
+        }
+    }
+
+    return;
+}
+
+// (This is defined after executeCommand(), which it uses to start commands.)
+static int startQueuedJobs(struct jobTable* jobTable);
+
+// This function deals with every signal that has arrived (see readSignals()):
+//   - SIGCHLD: every child that has finished is reaped, and the background
+//     processes among them are reported. If no SIGCHLD has arrived, this
+//     costs nothing, no matter how many background processes are running.
+//     If one has, a single waitpid(-1, WNOHANG) loop collects all of them
+//     (one SIGCHLD can stand for several children). Then any queued commands
+//     that there's room for are started. This is only called between
+//     commands, when that is safe.
+//   - SIGTSTP toggles foreground-only mode. One that arrived while a
+//     foreground command was running is only acted on now, after it is done.
+//   - SIGINT, at the prompt, throws away the line that was being typed (the
+//     terminal has already thrown away its copy). Anywhere else, it was meant
+//     for a foreground command, and we ignore it.
+// atPrompt should be TRUE if the prompt has already been output. Returns TRUE
+// if anything was output (so that the prompt should be output again).
+static int handleSignals
+(
+    struct eventLoop* eventLoop,
+    struct jobTable* jobTable,
+    int* usingBackgroundIsPossible,
+    int atPrompt
+)
+{
+    int reportsOutput = 0;
+
+    readSignals(eventLoop);
+
+    if (eventLoop->sigchldArrived == TRUE)
+    {
+        int childExitMethod = -5;
+        pid_t processID;
+
+        eventLoop->sigchldArrived = FALSE;
+
+        while ((processID = waitpid(-1, &childExitMethod, WNOHANG)) > 0)
+        {
+            if
+            (
+                reportFinishedBackgroundProcess
+                (
+                    processID,
+                    childExitMethod,
+                    jobTable,
+                    atPrompt == TRUE && reportsOutput == 0
+                ) == TRUE
+            )
+            {
+                reportsOutput++;
+            }
+        }
+    }
+
+    // (At the prompt, a queued command is only started once a report has
+    // moved us off of the prompt's line, so that its "background pid is"
+    // line doesn't end up there.)
+    if ((atPrompt == FALSE || reportsOutput > 0) &&
+        startQueuedJobs(jobTable) > 0)
+    {
+        reportsOutput++;
+    }
+
+    if (eventLoop->sigtstpArrived == TRUE)
+    {
+        eventLoop->sigtstpArrived = FALSE;
+        implementSigtstpLogic(usingBackgroundIsPossible);
+        reportsOutput++;
+    }
+
+    if (eventLoop->sigintArrived == TRUE)
+    {
+        eventLoop->sigintArrived = FALSE;
+        if (atPrompt == TRUE)
+        {
+            outputStringWithANewline("");
+            reportsOutput++;
+        }
+    }
+
+    return reportsOutput > 0;
+}
+
+// This function waits until there is input, dealing with signals (see
+// handleSignals()) as soon as they arrive instead of after the user's next
+// command. It is only used when we don't already have a line of input waiting.
+// If the input is interactive, the prompt is output again after anything that
+// handling a signal outputs. Captured background output (see struct jobLog)
+// is read as it arrives, too, and background jobs' deadlines are enforced as
+// they pass.
+static void waitForInput
+(
+    struct eventLoop* eventLoop,
+    struct inputReader* reader,
+    struct jobTable* jobTable,
+    int* usingBackgroundIsPossible
+)
+{
+    struct epoll_event events[4];
+
+    while (TRUE)
+    {
+        int eventCount = epoll_wait(eventLoop->epollFD, events, 4, -1);
+        int inputIsReady = FALSE;
+        int i;
+
+        for (i = 0; i < eventCount; i++)
+        {
+            if (events[i].data.fd == jobTable->logEpollFD)
+            {
+                readJobLogs(jobTable);
+            }
+            else if (events[i].data.fd == jobTable->timerFD)
+            {
+                enforceDeadlines(jobTable);
+            }
+            else if (events[i].data.fd != eventLoop->signalFD)
+            {
+                inputIsReady = TRUE;
+            }
+            else if
+            (
+                handleSignals
+                (
+                    eventLoop,
+                    jobTable,
+                    usingBackgroundIsPossible,
+                    TRUE
+                ) == TRUE &&
+                reader->interactive == TRUE
+            )
+            {
+                outputStringWithNoNewline(": "); // Output the prompt again.
+            }
+        }
+
+        if (inputIsReady == TRUE)
+        {
+            return;
+        }
+    }
+}
+
+// This function waits for any child process to finish, and returns its pid
+// (or -1 if there are no children left), filling in how it ended and what
+// resources it used. Signals that arrive in the meantime are only noted, for
+// handleSignals() to deal with later. Captured background output is read as
+// it arrives, and background jobs' deadlines are enforced, so that background
+// jobs don't have to wait for the foreground one. If deadline (a
+// CLOCK_MONOTONIC time in nanoseconds) isn't 0, this returns 0 if nothing
+// finishes before then.
+static pid_t waitForChild
+(
+    struct eventLoop* eventLoop,
+    struct jobTable* jobTable,
+    long long deadline,
+    int* childExitMethod,
+    struct rusage* usage
+)
+{
+    // (poll() skips the log epoll fd if it's -1.)
+    struct pollfd watched[3];
+    watched[0].fd = eventLoop->signalFD;
+    watched[0].events = POLLIN;
+    watched[1].fd = jobTable->logEpollFD;
+    watched[1].events = POLLIN;
+    watched[2].fd = jobTable->timerFD;
+    watched[2].events = POLLIN;
+
+    while (TRUE)
+    {
+        // wait4() is waitpid() that also tells us what resources the child
+        // used:
+        pid_t processID = wait4(-1, childExitMethod, WNOHANG, usage);
+
+        if (processID != 0)
+        {
+            return processID;
+        }
+
+        // Nothing has finished yet. The next SIGCHLD (or other signal) will
+        // wake us up; if one arrives between the wait4() and the poll(), it
+        // is waiting in the signalfd, so we can't miss it.
+        int timeout = -1;
+        if (deadline != 0)
+        {
+            long long left = deadline - monotonicNanoseconds();
+            if (left <= 0)
+            {
+                return 0;
+            }
+            // Round up, so that we don't wake up just before the deadline:
+            timeout = (int)((left + 999999) / 1000000);
+        }
+
+        poll(watched, 3, timeout);
+        readSignals(eventLoop);
+        eventLoop->sigchldArrived = FALSE;
+        readJobLogs(jobTable);
+        if (watched[2].revents != 0)
+        {
+            enforceDeadlines(jobTable);
+        }
+    }
+}
+
+// This function returns a pidfd for the given process: a file descriptor that
+// poll() reports as readable once the process has finished. Returns -1 if
+// the kernel can't do that (pidfds are new in Linux 5.3).
+static int openProcessFD(pid_t processID)
+{
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, processID, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// This function implements the "wait" built-in command:
+//   wait [PID...] [-t SECONDS]
+// It waits for the given background processes (or, if none are given, all
+// of them) to finish, reporting each one as it finishes, just as they are
+// reported at the prompt. With -t, it gives up once that many seconds (which
+// may be a fraction) have passed. We open a pidfd for each process and
+// poll() them all at once, along with the signalfd, so we sleep in a single
+// system call until something finishes, the time runs out, or Ctrl-C is
+// pressed (which stops the waiting, but not the processes). For "status",
+// the result is how the last of the processes finished, 124 if the time ran
+// out first (as for the timeout command), 130 for Ctrl-C, and 127 if a PID
+// isn't one of our background processes (as in bash).
+static void waitBuiltIn
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct jobTable* jobTable,
+    struct eventLoop* eventLoop,
+    int* statusType,
+    int* statusValue
+)
+{
+    double timeLimit = -1;
+    int pidCount = 0;
+    int i;
+
+    *statusType = EXIT_VALUE;
+    *statusValue = 0;
+
+    // There's at most one process for each word, or one for each job:
+    int maximumCount = (arrayElementsUsed > jobTable->count) ?
+                       arrayElementsUsed : jobTable->count;
+    pid_t* processIDs = malloc(maximumCount * sizeof(pid_t));
+    struct pollfd* watched = malloc((maximumCount + 3) * sizeof(struct pollfd));
+    if (processIDs == NULL || watched == NULL)
+    {
+        perror("Error when allocating memory for wait!");
+        exit(1);
+    }
+
+    for (i = 1; i < arrayElementsUsed; i++)
+    {
+        char* end;
+
+        if (strcmp(commandArray[i], "-t") == 0 && i + 1 < arrayElementsUsed)
+        {
+            i++;
+            timeLimit = strtod(commandArray[i], &end);
+            if (*end != 0 || end == commandArray[i] || timeLimit < 0)
+            {
+                fprintf(stderr, "wait: %s: invalid number of seconds\n",
+                        commandArray[i]);
+                *statusValue = 2;
+                free(processIDs);
+                free(watched);
+                return;
+            }
+            continue;
+        }
+
+        long processID = strtol(commandArray[i], &end, 10);
+        if (*end != 0 || end == commandArray[i] || processID <= 0 ||
+            findJob(jobTable, processID) == NULL)
+        {
+            fprintf(stderr, "wait: %s is not a background process of this "
+                    "shell\n", commandArray[i]);
+            *statusValue = 127;
+            continue;
+        }
+        processIDs[pidCount] = processID;
+        pidCount++;
+    }
+
+    // Without PIDs, we wait for all of the background processes. Queued
+    // commands (see queueBackgroundJob()) are started as those finish, and
+    // then we go around again to wait for them, too:
+    int waitForAll = (pidCount == 0 && *statusValue == 0);
+    long long deadline = monotonicNanoseconds() +
+                         (long long)(timeLimit * 1000000000.0);
+    int remaining;
+    int startedMore;
+
+    while (TRUE)
+    {
+        if (waitForAll == TRUE)
+        {
+            if (jobTable->count > maximumCount)
+            {
+                maximumCount = jobTable->count;
+                processIDs = realloc(processIDs, maximumCount * sizeof(pid_t));
+                watched = realloc
+                (
+                    watched,
+                    (maximumCount + 3) * sizeof(struct pollfd)
+                );
+                if (processIDs == NULL || watched == NULL)
+                {
+                    perror("Error when allocating memory for wait!");
+                    exit(1);
+                }
+            }
+
+            struct job** jobs = listJobsInOrder(jobTable);
+            for (i = 0; i < jobTable->count; i++)
+            {
+                processIDs[i] = jobs[i]->processID;
+            }
+            pidCount = jobTable->count;
+            free(jobs);
+        }
+
+        for (i = 0; i < pidCount; i++)
+        {
+            watched[i].fd = openProcessFD(processIDs[i]);
+            watched[i].events = POLLIN;
+        }
+        // If pidfds aren't available, SIGCHLD (on the signalfd) wakes us up,
+        // and we check on the processes one at a time:
+        watched[pidCount].fd = eventLoop->signalFD;
+        watched[pidCount].events = POLLIN;
+        // Captured output (see struct jobLog) is read while we wait:
+        watched[pidCount + 1].fd = jobTable->logEpollFD;
+        watched[pidCount + 1].events = POLLIN;
+        // And "timeout"s still run out:
+        watched[pidCount + 2].fd = jobTable->timerFD;
+        watched[pidCount + 2].events = POLLIN;
+
+        remaining = pidCount;
+        startedMore = FALSE;
+
+        while (remaining > 0)
+        {
+            int timeout = -1;
+            if (timeLimit >= 0)
+            {
+                long long left = deadline - monotonicNanoseconds();
+                if (left <= 0)
+                {
+                    *statusType = EXIT_VALUE;
+                    *statusValue = 124;
+                    break;
+                }
+                // Round up, so that we don't wake up just before the deadline:
+                timeout = (int)((left + 999999) / 1000000);
+            }
+
+            if (poll(watched, pidCount + 3, timeout) == -1 && errno != EINTR)
+            {
+                perror("Error when waiting for background processes!");
+                break;
+            }
+
+            if (watched[pidCount + 1].revents != 0)
+            {
+                readJobLogs(jobTable);
+            }
+            if (watched[pidCount + 2].revents != 0)
+            {
+                enforceDeadlines(jobTable);
+            }
+
+            if (watched[pidCount].revents != 0)
+            {
+                // Anything other than Ctrl-C is left for handleSignals():
+                readSignals(eventLoop);
+                if (eventLoop->sigintArrived == TRUE)
+                {
+                    eventLoop->sigintArrived = FALSE;
+                    outputStringWithANewline("");
+                    *statusType = EXIT_VALUE;
+                    *statusValue = 130;
+                    break;
+                }
+            }
+
+            for (i = 0; i < pidCount; i++)
+            {
+                if (processIDs[i] == -1 ||
+                    (watched[i].fd != -1 && watched[i].revents == 0))
+                {
+                    continue;
+                }
+
+                int childExitMethod;
+                pid_t result =
+                    waitpid(processIDs[i], &childExitMethod, WNOHANG);
+                if (result == 0)
+                {
+                    continue; // Still running.
+                }
+
+                // (If waitpid() failed, the same PID was given twice, and it
+                // has already been reported.)
+                if (result > 0)
+                {
+                    reportFinishedBackgroundProcess
+                    (
+                        processIDs[i],
+                        childExitMethod,
+                        jobTable,
+                        FALSE
+                    );
+
+                    if (WIFEXITED(childExitMethod) != 0)
+                    {
+                        *statusType = EXIT_VALUE;
+                        *statusValue = WEXITSTATUS(childExitMethod);
+                    }
+                    else
+                    {
+                        *statusType = SIGNAL_RECEIVED;
+                        *statusValue = WTERMSIG(childExitMethod);
+                    }
+                }
+
+                if (watched[i].fd != -1)
+                {
+                    close(watched[i].fd);
+                }
+                // poll() skips entries with negative file descriptors:
+                watched[i].fd = -1;
+                processIDs[i] = -1;
+                remaining--;
+            }
+
+            // Whatever finished may have made room for queued commands:
+            if (startQueuedJobs(jobTable) > 0 && waitForAll == TRUE)
+            {
+                startedMore = TRUE;
+                break;
+            }
+        }
+
+        for (i = 0; i < pidCount; i++)
+        {
+            if (processIDs[i] != -1 && watched[i].fd != -1)
+            {
+                close(watched[i].fd);
+            }
+        }
+
+        if (waitForAll == FALSE || (remaining > 0 && startedMore == FALSE) ||
+            jobTable->count == 0)
+        {
+            break;
+        }
+    }
+
+    free(processIDs);
+    free(watched);
+
+    return;
+}
+
+// This function returns "size" bytes from the arena. The memory stays valid
+// until the next resetArena() call. Blocks are kept around after a reset, so
+// in the common case this is just a pointer bump:
+static char* allocateFromArena(struct wordArena* arena, size_t size)
+{
+    // Keep everything we hand out aligned, in case we ever store something
+    // other than characters here:
+    size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    struct arenaBlock* block = arena->current;
+
+    // Look for a block (starting with the current one) that has enough room
+    // left over:
+    while (block != NULL && block->size - block->used < size)
+    {
+        block = block->next;
+    }
+
+    if (block == NULL)
+    {
+        // None of the blocks we already have is big enough, so we make a new
+        // one and put it right after the current block:
+        size_t blockSize = ARENA_BLOCK_SIZE;
+        if (size > blockSize)
+        {
+            blockSize = size;
+        }
+
+        block = malloc(sizeof(struct arenaBlock) + blockSize);
+        if (block == NULL)
+        {
+            perror("Error when allocating memory for a command!");
+            exit(1);
+        }
+        block->size = blockSize;
+        block->used = 0;
+
+        if (arena->current == NULL)
+        {
+            block->next = NULL;
+            arena->first = block;
+        }
+        else
+        {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        }
+    }
+
+    arena->current = block;
+
+    char* memory = block->data + block->used;
+    block->used += size;
+
+    return memory;
+}
+
+// This function makes all of the arena's memory available again. It doesn't
+// give it back to the system, so the next command can reuse it, except for
+// blocks that are bigger than usual (made for one very long word, such as a
+// big here-document), which one command shouldn't keep forever:
+static void resetArena(struct wordArena* arena)
+{
+    struct arenaBlock** link = &arena->first;
+
+    while (*link != NULL)
+    {
+        struct arenaBlock* block = *link;
+
+        if (block->size > ARENA_BLOCK_SIZE)
+        {
+            *link = block->next;
+            free(block);
+            continue;
+        }
+
+        block->used = 0;
+        link = &block->next;
+    }
+
+    arena->current = arena->first;
+
+    return;
+}
+
+// This function gives all of the arena's memory back to the system, for arenas
+// that are only needed for a little while:
+static void freeArena(struct wordArena* arena)
+{
+    struct arenaBlock* block = arena->first;
+    while (block != NULL)
+    {
+        struct arenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->first = NULL;
+    arena->current = NULL;
+
+    return;
+}
+
+// This function sets up an input reader for the given file descriptor.
+// Prompts are only output if "interactive" is TRUE.
+static void openInputReader(struct inputReader* reader, int fd, int interactive)
+{
+    reader->fd = fd;
+    reader->capacity = INPUT_BLOCK_SIZE;
+    reader->buffer = malloc(reader->capacity + 1);
+    if (reader->buffer == NULL)
+    {
+        perror("Error when allocating the input buffer!");
+        exit(1);
+    }
+    reader->start = 0;
+    reader->end = 0;
+    reader->atEndOfFile = FALSE;
+    reader->interactive = interactive;
+
+    return;
+}
+
+// This function sets up an input reader that reads the given string (for
+// "smallsh -c"). There is nothing more to read after the string.
+static void openStringInputReader(struct inputReader* reader, char* text)
+{
+    size_t length = strlen(text);
+
+    reader->fd = -1;
+    reader->capacity = length;
+    reader->buffer = malloc(length + 1);
+    if (reader->buffer == NULL)
+    {
+        perror("Error when allocating the input buffer!");
+        exit(1);
+    }
+    memcpy(reader->buffer, text, length);
+    reader->start = 0;
+    reader->end = length;
+    reader->atEndOfFile = TRUE;
+    reader->interactive = FALSE;
+
+    return;
+}
+
+// This function returns TRUE if the reader already has a whole line (or the
+// last bit of input before end-of-file) waiting, so that reading it won't
+// block:
+static int inputIsBuffered(struct inputReader* reader)
+{
+    return memchr(reader->buffer + reader->start, '\n',
+                  reader->end - reader->start) != NULL ||
+           (reader->atEndOfFile == TRUE && reader->end > reader->start);
+}
+
+// This function gets the next line of input. Input is read in blocks of
+// INPUT_BLOCK_SIZE bytes (a terminal only ever hands over one line at a
+// time, but files and pipes hand over as much as we ask for), and lines are
+// returned in place: *line points into the reader's buffer, with the \n
+// turned into a \0. It stays valid until the next call. Returns TRUE if there
+// is a line, FALSE at end-of-file, and -1 if a signal interrupted the read.
+static int readInputLine(struct inputReader* reader, char** line)
+{
+    char* newline;
+
+    while ((newline = memchr(reader->buffer + reader->start, '\n',
+                             reader->end - reader->start)) == NULL)
+    {
+        if (reader->atEndOfFile == TRUE)
+        {
+            if (reader->end == reader->start)
+            {
+                return FALSE;
+            }
+
+            // The input ended without a final \n; that's still a line.
+            newline = reader->buffer + reader->end;
+            break;
+        }
+
+        // Move the part of a line that we already have to the front of the
+        // buffer, so that there's room after it for the rest:
+        if (reader->start > 0)
+        {
+            memmove(reader->buffer, reader->buffer + reader->start,
+                    reader->end - reader->start);
+            reader->end -= reader->start;
+            reader->start = 0;
+        }
+
+        // If the line is longer than the whole buffer, make the buffer bigger:
+        if (reader->end == reader->capacity)
+        {
+            reader->capacity *= 2;
+            reader->buffer = realloc(reader->buffer, reader->capacity + 1);
+            if (reader->buffer == NULL)
+            {
+                perror("Error when allocating the input buffer!");
+                exit(1);
+            }
+        }
+
+        ssize_t bytesRead = read(reader->fd, reader->buffer + reader->end,
+                                 reader->capacity - reader->end);
+
+        if (bytesRead == -1)
+        {
+            if (errno == EINTR)
+            {
+                return -1;
+            }
+            perror("Error when reading input!");
+            reader->atEndOfFile = TRUE;
+        }
+        else if (bytesRead == 0)
+        {
+            reader->atEndOfFile = TRUE;
+        }
+        else
+        {
+            reader->end += bytesRead;
+        }
+    }
+
+    *newline = 0; // Turn ending \n into a \0.
+    *line = reader->buffer + reader->start;
+    reader->start = (newline - reader->buffer) + 1;
+    if (reader->start > reader->end)
+    {
+        reader->start = reader->end;
+    }
+
+    return TRUE;
+}
+
+// This function makes sure that wordList has room for wordCount words (and
+// the NULL after them), doubling its size as many times as it takes. Returns
+// FALSE (after reporting the problem) if that's more words than we can count.
+static int makeRoomForWords(struct wordList* wordList, int wordCount)
+{
+    int newCapacity = (wordList->words == NULL) ?
+                      FIRST_WORD_LIST_SIZE : wordList->capacity;
+
+    while (newCapacity < wordCount)
+    {
+        if (newCapacity > INT_MAX / 2 - 1)
+        {
+            fprintf(stderr, "smallsh: too many words in one line\n");
+            return FALSE;
+        }
+        newCapacity *= 2;
+    }
+
+    if (wordList->words == NULL || newCapacity != wordList->capacity)
+    {
+        wordList->words = realloc(wordList->words,
+                                  (newCapacity + 1) * sizeof(char*));
+        if (wordList->words == NULL)
+        {
+            perror("Error when allocating memory for words!");
+            exit(1);
+        }
+        wordList->capacity = newCapacity;
+    }
+
+    return TRUE;
+}
+
+// This function splits a line into words, and returns the number of words.
+// The words are not copied anywhere: each element of wordList->words points
+// straight into the line. The array of pointers is doubled in size whenever
+// it fills up, and is kept for the next line, so it only ever grows as big as
+// the longest line needs.
+static int splitIntoWords(char* line, struct wordList* wordList)
+{
+    char* token = NULL;
+    int index = 0;
+
+    makeRoomForWords(wordList, 0);
+
+    // strtok() writes a \0 after each word that it finds, so the line buffer
+    // itself ends up holding every word, and we only need to note where each
+    // one starts:
+    token = strtok(line, COMMAND_AND_ARGUMENT_DELIMITER);
+    while (token != NULL)
+    {
+        if (index == wordList->capacity &&
+            makeRoomForWords(wordList, index + 1) == FALSE)
+        {
+            break;
+        }
+
+        wordList->words[index] = token;
+        index++;
+        token = strtok(NULL, COMMAND_AND_ARGUMENT_DELIMITER);
+    }
+    wordList->words[index] = NULL;
+
+    return index;
+}
+
+// This function outputs "prompt" (if the input is interactive) and gets the
+// next line of input into *line, dealing with signals while it waits (see
+// waitForInput()). Returns FALSE when there is no more input.
+static int readLineWhenReady
+(
+    struct inputReader* reader,
+    char* prompt,
+    char** line,
+    struct eventLoop* eventLoop,
+    struct jobTable* jobTable,
+    int* usingBackgroundIsPossible
+)
+{
+    int result;
+
+    while(TRUE)
+    {
+        if (reader->interactive == TRUE)
+        {
+            outputStringWithNoNewline(prompt); // Output prompt.
+        }
+
+        // (A reader that has reached the end of its input, like one that
+        // reads a string, never has to wait.)
+        if (eventLoop->watchingInput == TRUE &&
+            reader->atEndOfFile == FALSE &&
+            inputIsBuffered(reader) == FALSE)
+        {
+            waitForInput
+            (
+                eventLoop,
+                reader,
+                jobTable,
+                usingBackgroundIsPossible
+            );
+        }
+
+        result = readInputLine(reader, line);
+        // Get a line from the user.
+
+        if (result == FALSE)
+        {
+            if (reader->interactive == TRUE)
+            {
+                outputStringWithANewline(""); // Move past the prompt.
+            }
+            return FALSE;
+        }
+        else if (result == TRUE)
+        {
+            return TRUE;
+        }
+        // Otherwise, a signal interrupted us. Try again.
+    }
+}
+
+// Output prompt (if the input is interactive), get line of input, and split
+// that input into words, noting the total number of words found. The words
+// are not copied anywhere: each element of wordList->words points straight
+// into the reader's buffer, and stays valid until the next line is read.
+// Returns FALSE when there is no more input.
+static int getCommandArray
+(
+    struct inputReader* reader,
+    struct wordList* wordList,
+    int* arrayElementsUsed,
+    struct eventLoop* eventLoop,
+    struct jobTable* jobTable,
+    int* usingBackgroundIsPossible,
+    struct commandTrace* trace
+)
+{
+    char* lineEntered = NULL;
+
+    if
+    (
+        readLineWhenReady
+        (
+            reader,
+            ": ",
+            &lineEntered,
+            eventLoop,
+            jobTable,
+            usingBackgroundIsPossible
+        ) == FALSE
+    )
+    {
+        return FALSE;
+    }
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->readTime = monotonicNanoseconds();
+    }
+
+    *arrayElementsUsed = splitIntoWords(lineEntered, wordList);
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->tokenizeTime = monotonicNanoseconds();
+    }
+
+    return TRUE;
+}
+
+// This function reads the bodies of the line's here-documents ("cmd << END",
+// or "cmd <<END"): the lines after it, up to one that is just END. Each body
+// becomes a single word, the one after a REDIRECT_HERE_DOCUMENT, which is
+// where findRedirections() looks for it; so once the bodies are read, the
+// rest of the shell treats them like the word of a here-string. (Since they
+// are read before "$$" is expanded, "$$" in a body is expanded, too, as in
+// bash.) Reading more lines can move the reader's buffer, which the line's
+// words point into, so when there's a here-document the words are first
+// copied into the arena, along with the bodies. reader is where the bodies
+// come from; if it is NULL, the line can't have any. Returns FALSE (after
+// reporting the problem) if the line's here-documents can't be read.
+static int collectHereDocuments
+(
+    struct wordList* wordList,
+    int* arrayElementsUsed,
+    struct wordArena* arena,
+    struct inputReader* reader,
+    struct eventLoop* eventLoop,
+    struct jobTable* jobTable,
+    int* usingBackgroundIsPossible
+)
+{
+    int hereDocumentCount = 0;
+    int i;
+
+    // Most lines don't have any, which takes only this to find out. Along
+    // the way, "<<<WORD" is split into "<<<" and "WORD", the same way that
+    // "<<END" is below (so that it isn't mistaken for "<<" with "<WORD" as
+    // its delimiter). The word after a "<<<" is never a here-document,
+    // whatever it starts with.
+    for (i = 0; i < *arrayElementsUsed; i++)
+    {
+        char* word = wordList->words[i];
+
+        if (strncmp(word, REDIRECT_HERE_STRING, 3) == 0 && word[3] != 0)
+        {
+            if (makeRoomForWords(wordList, *arrayElementsUsed + 1) == FALSE)
+            {
+                return FALSE;
+            }
+            memmove(&wordList->words[i + 2], &wordList->words[i + 1],
+                    (*arrayElementsUsed - i) * sizeof(char*));
+            (*arrayElementsUsed)++;
+            wordList->words[i] = REDIRECT_HERE_STRING;
+            wordList->words[i + 1] = word + 3;
+            i++;
+        }
+        else if (strcmp(word, REDIRECT_HERE_STRING) == 0)
+        {
+            i++;
+        }
+        else if (strncmp(word, REDIRECT_HERE_DOCUMENT, 2) == 0)
+        {
+            hereDocumentCount++;
+        }
+    }
+    if (hereDocumentCount == 0)
+    {
+        return TRUE;
+    }
+
+    if (reader == NULL)
+    {
+        outputStringWithANewline("smallsh: a here-document needs the lines "
+                                 "after it");
+        return FALSE;
+    }
+
+    for (i = 0; i < *arrayElementsUsed; i++)
+    {
+        size_t length = strlen(wordList->words[i]);
+        char* copy = allocateFromArena(arena, length + 1);
+        memcpy(copy, wordList->words[i], length + 1);
+        wordList->words[i] = copy;
+    }
+
+    for (i = 0; i < *arrayElementsUsed; i++)
+    {
+        char* word = wordList->words[i];
+        if (strcmp(word, REDIRECT_HERE_STRING) == 0)
+        {
+            i++; // Its word is text, not a here-document.
+            continue;
+        }
+        if (strncmp(word, REDIRECT_HERE_DOCUMENT, 2) != 0)
+        {
+            continue;
+        }
+
+        char* delimiter;
+        if (strcmp(word, REDIRECT_HERE_DOCUMENT) == 0)
+        {
+            if (i + 1 == *arrayElementsUsed)
+            {
+                outputStringWithANewline("smallsh: missing here-document "
+                                         "delimiter after <<");
+                return FALSE;
+            }
+            delimiter = wordList->words[i + 1];
+        }
+        else
+        {
+            // "<<END" is split into "<<" and "END", so that there's a word
+            // after the "<<" for the body to go in:
+            if (makeRoomForWords(wordList, *arrayElementsUsed + 1) == FALSE)
+            {
+                return FALSE;
+            }
+            memmove(&wordList->words[i + 2], &wordList->words[i + 1],
+                    (*arrayElementsUsed - i) * sizeof(char*));
+            (*arrayElementsUsed)++;
+            wordList->words[i] = REDIRECT_HERE_DOCUMENT;
+            delimiter = word + 2;
+        }
+
+        // The lines move around in the reader's buffer, so each one is copied
+        // as soon as it's read:
+        size_t bodyLength = 0;
+        size_t bodyCapacity = INPUT_BLOCK_SIZE;
+        char* body = malloc(bodyCapacity);
+        char* line;
+        if (body == NULL)
+        {
+            perror("Error when allocating memory for a here-document!");
+            exit(1);
+        }
+
+        while (TRUE)
+        {
+            if
+            (
+                readLineWhenReady
+                (
+                    reader,
+                    "> ",
+                    &line,
+                    eventLoop,
+                    jobTable,
+                    usingBackgroundIsPossible
+                ) == FALSE
+            )
+            {
+                fprintf(stderr, "smallsh: here-document ended without "
+                        "\"%s\"\n", delimiter);
+                break;
+            }
+
+            if (strcmp(line, delimiter) == 0)
+            {
+                break;
+            }
+
+            size_t lineLength = strlen(line);
+            while (bodyLength + lineLength + 1 > bodyCapacity)
+            {
+                bodyCapacity *= 2;
+                body = realloc(body, bodyCapacity);
+                if (body == NULL)
+                {
+                    perror("Error when allocating memory for a "
+                           "here-document!");
+                    exit(1);
+                }
+            }
+            memcpy(body + bodyLength, line, lineLength);
+            body[bodyLength + lineLength] = '\n';
+            bodyLength += lineLength + 1;
+        }
+
+        char* bodyWord = allocateFromArena(arena, bodyLength + 1);
+        memcpy(bodyWord, body, bodyLength);
+        bodyWord[bodyLength] = 0;
+        free(body);
+
+        wordList->words[i + 1] = bodyWord;
+        i++; // The body isn't looked at again.
+    }
+
+    return TRUE;
+}
+
+// Replace each instance of "$$" with the process ID. processIdString is the
+// shell's pid, which smallshCreate() formats once, since it never changes.
+// Each word is scanned once to count its "$$"s, and once more to copy it (with
+// the substitutions) into exactly as much arena memory as the result needs,
+// so neither the number of "$$"s nor the length of the word is limited.
+static void replaceDoubleDollarSigns
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct wordArena* arena,
+    char* processIdString
+)
+{
+    size_t pidLength = strlen(processIdString);
+
+    // Iterate over each word in the array:
+    int i;
+    for (i = 0; i < arrayElementsUsed; i++) {
+
+        // Most words don't contain "$$" at all, and those can stay right
+        // where they are in the line buffer. The others get a new copy in the
+        // arena, since they are about to get longer:
+        char* dollars = strstr(commandArray[i], "$$");
+        if (dollars == NULL)
+        {
+            continue;
+        }
+
+        // Count the "$$"s, left to right ("$$$" is one "$$" and then a "$"):
+        size_t count = 0;
+        while (dollars != NULL)
+        {
+            count++;
+            dollars = strstr(dollars + 2, "$$");
+        }
+
+        size_t wordLength = strlen(commandArray[i]);
+        char* newWord = allocateFromArena
+        (
+            arena,
+            wordLength - 2 * count + count * pidLength + 1
+        );
+
+        char* from = commandArray[i];
+        char* to = newWord;
+
+        while ((dollars = strstr(from, "$$")) != NULL)
+        {
+            // Copy in the characters that come before the "$$", and then
+            // the process ID in its place:
+            memcpy(to, from, dollars - from);
+            to += dollars - from;
+            memcpy(to, processIdString, pidLength);
+            to += pidLength;
+            from = dollars + 2;
+        }
+
+        // Copy in the rest of the word, including its \0:
+        strcpy(to, from);
+
+        commandArray[i] = newWord;
+    }
+
+    return;
+}
+
+// The next several functions implement wildcards. A word with a *, ?, or
+// [...] in it is a pattern, and it's replaced by the names of the files that
+// it matches, in sorted order. (If nothing matches, the word is left alone.)
+
+// This function returns TRUE if the text from "start" to "end" has a
+// wildcard in it. A [ only counts if there's a ] somewhere after it, so "["
+// on its own (the test command) is never looked up as a pattern.
+static int hasWildcard(char* start, char* end)
+{
+    char* next;
+    for (next = start; next < end; next++)
+    {
+        if (*next == '*' || *next == '?' ||
+            (*next == '[' && memchr(next + 1, ']', end - next - 1) != NULL))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// This function checks whether the character "c" matches the single pattern
+// element (a character, a ?, or a [...] list) that starts at "pattern". It
+// returns a pointer to just past that element if it does, and NULL if it
+// doesn't. A list can be negated with ! or ^ and can hold ranges like a-z; a
+// ] right after the [ (or the ! or ^) is part of the list. A [ that has no ]
+// to close it is just a [.
+static char* matchOneCharacter(char* pattern, char* patternEnd, char c)
+{
+    if (*pattern == '?')
+    {
+        return pattern + 1;
+    }
+
+    if (*pattern == '[')
+    {
+        char* next = pattern + 1;
+        int negated = FALSE;
+        int matched = FALSE;
+
+        if (next < patternEnd && (*next == '!' || *next == '^'))
+        {
+            negated = TRUE;
+            next++;
+        }
+
+        char* listStart = next;
+        while (next < patternEnd && (*next != ']' || next == listStart))
+        {
+            if (next + 2 < patternEnd && next[1] == '-' && next[2] != ']')
+            {
+                if ((unsigned char) c >= (unsigned char) next[0] &&
+                    (unsigned char) c <= (unsigned char) next[2])
+                {
+                    matched = TRUE;
+                }
+                next += 3;
+            }
+            else
+            {
+                if (c == *next)
+                {
+                    matched = TRUE;
+                }
+                next++;
+            }
+        }
+
+        if (next < patternEnd)
+        {
+            // We found the ], so it really was a list:
+            return (matched != negated) ? next + 1 : NULL;
+        }
+        // Otherwise, fall through and treat the [ as an ordinary character.
+    }
+
+    return (*pattern == c) ? pattern + 1 : NULL;
+}
+
+// This function checks whether a file name matches one component of a
+// pattern (the part from "pattern" to "patternEnd", which has no / in it).
+// Nothing is allocated or copied, so every entry of a big directory can be
+// checked right where getdents64() put it. When a * doesn't work out, we go
+// back to the most recent * and let it swallow one more character, which is
+// all the backtracking that's ever needed.
+static int nameMatchesPattern(char* pattern, char* patternEnd, char* name)
+{
+    char* lastStar = NULL;
+    char* nameAfterLastStar = NULL;
+
+    while (*name != 0)
+    {
+        if (pattern < patternEnd && *pattern == '*')
+        {
+            pattern++;
+            lastStar = pattern;
+            nameAfterLastStar = name;
+            continue;
+        }
+
+        char* next = NULL;
+        if (pattern < patternEnd)
+        {
+            next = matchOneCharacter(pattern, patternEnd, *name);
+        }
+
+        if (next != NULL)
+        {
+            pattern = next;
+            name++;
+        }
+        else if (lastStar != NULL)
+        {
+            pattern = lastStar;
+            nameAfterLastStar++;
+            name = nameAfterLastStar;
+        }
+        else
+        {
+            return FALSE;
+        }
+    }
+
+    while (pattern < patternEnd && *pattern == '*')
+    {
+        pattern++;
+    }
+
+    return pattern == patternEnd;
+}
+
+// This function adds a name to the list of names that a pattern matched,
+// making the list bigger if it's full:
+static void addGlobMatch(struct globMatches* matches, char* name)
+{
+    if (matches->count == matches->capacity)
+    {
+        matches->capacity = (matches->capacity == 0) ?
+                            FIRST_GLOB_MATCH_LIST_SIZE : matches->capacity * 2;
+        matches->names = realloc(matches->names,
+                                 matches->capacity * sizeof(char*));
+        if (matches->names == NULL)
+        {
+            perror("Error when allocating memory for wildcard matches!");
+            exit(1);
+        }
+    }
+
+    matches->names[matches->count] = name;
+    matches->count++;
+
+    return;
+}
+
+// This function finds the files that match "pattern" inside the directory
+// "path" (which is pathLength characters long, and is either empty, meaning
+// the current directory, or ends with a /). The names it finds (with "path"
+// in front of them) are copied into the arena and added to "matches".
+//
+// Components of the pattern without wildcards are simply added on to the
+// path. For one with wildcards, we read the directory with getdents64(),
+// GLOB_BUFFER_SIZE bytes of entries per system call, instead of one entry at
+// a time. If there's more of the pattern after it, we finish reading the
+// directory before going into the subdirectories that matched, so that only
+// one buffer is ever needed, however deep the pattern goes.
+static void findGlobMatches
+(
+    char* pattern,
+    char* path,
+    size_t pathLength,
+    struct globMatches* matches,
+    struct wordArena* arena
+)
+{
+    // Add on components without wildcards:
+    while (TRUE)
+    {
+        if (*pattern == 0)
+        {
+            // The whole pattern has been used up, so the path is a match if
+            // it exists. (We only get here if there were wildcards earlier
+            // on, or the pattern ended with a /.)
+            struct stat fileInfo;
+            path[pathLength] = 0;
+            if (pathLength > 0 && stat(path, &fileInfo) == 0)
+            {
+                char* name = allocateFromArena(arena, pathLength + 1);
+                memcpy(name, path, pathLength + 1);
+                addGlobMatch(matches, name);
+            }
+            return;
+        }
+
+        char* componentEnd = strchrnul(pattern, '/');
+        size_t componentLength = componentEnd - pattern;
+        if (hasWildcard(pattern, componentEnd) == TRUE)
+        {
+            break;
+        }
+
+        if (pathLength + componentLength + 2 > PATH_MAX)
+        {
+            return;
+        }
+        memcpy(path + pathLength, pattern, componentLength);
+        pathLength += componentLength;
+
+        if (*componentEnd == 0)
+        {
+            pattern = componentEnd;
+        }
+        else
+        {
+            path[pathLength] = '/';
+            pathLength++;
+            pattern = componentEnd + 1;
+        }
+    }
+
+    char* componentEnd = strchrnul(pattern, '/');
+    char* restOfPattern = (*componentEnd == '/') ? componentEnd + 1 : NULL;
+
+    path[pathLength] = 0;
+    int directoryFD = open((pathLength == 0) ? "." : path,
+                           O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryFD == -1)
+    {
+        return;
+    }
+
+    // Subdirectories that matched, if there's more of the pattern to go:
+    struct globMatches subdirectories = {NULL, 0, 0, matches->buffer};
+
+    while (TRUE)
+    {
+        long bytesRead = syscall(SYS_getdents64, directoryFD, matches->buffer,
+                                 GLOB_BUFFER_SIZE);
+        if (bytesRead <= 0)
+        {
+            break;
+        }
+
+        long offset = 0;
+        while (offset < bytesRead)
+        {
+            struct directoryEntry* entry =
+                (struct directoryEntry*) (matches->buffer + offset);
+            offset += entry->recordLength;
+
+            char* name = entry->name;
+
+            // Hidden files (and . and ..) only match if the pattern itself
+            // starts with a dot, and . and .. never match:
+            if (name[0] == '.' &&
+                (*pattern != '.' || name[1] == 0 ||
+                 (name[1] == '.' && name[2] == 0)))
+            {
+                continue;
+            }
+
+            // If there's more pattern to go, only a directory (or something
+            // that might turn out to be one) can match:
+            if (restOfPattern != NULL && entry->type != DT_DIR &&
+                entry->type != DT_LNK && entry->type != DT_UNKNOWN)
+            {
+                continue;
+            }
+
+            if (nameMatchesPattern(pattern, componentEnd, name) == FALSE)
+            {
+                continue;
+            }
+
+            size_t nameLength = strlen(name);
+            if (pathLength + nameLength + 2 > PATH_MAX)
+            {
+                continue;
+            }
+
+            char* match = allocateFromArena(arena, pathLength + nameLength + 1);
+            memcpy(match, path, pathLength);
+            memcpy(match + pathLength, name, nameLength + 1);
+            if (restOfPattern == NULL)
+            {
+                addGlobMatch(matches, match);
+            }
+            else
+            {
+                addGlobMatch(&subdirectories, match);
+            }
+        }
+    }
+
+    close(directoryFD);
+
+    int i;
+    for (i = 0; i < subdirectories.count; i++)
+    {
+        size_t length = strlen(subdirectories.names[i]);
+        memcpy(path, subdirectories.names[i], length);
+        path[length] = '/';
+        findGlobMatches(restOfPattern, path, length + 1, matches, arena);
+    }
+    free(subdirectories.names);
+
+    return;
+}
+
+// This function is how qsort() compares two file names:
+static int compareFileNames(const void* first, const void* second)
+{
+    return strcmp(*(char* const*) first, *(char* const*) second);
+}
+
+// This function returns TRUE if the word is <, >, <<<, or <<:
+static int isRedirectionSymbol(char* word)
+{
+    return strcmp(word, REDIRECT_INPUT) == 0 ||
+           strcmp(word, REDIRECT_OUTPUT) == 0 ||
+           strcmp(word, REDIRECT_HERE_STRING) == 0 ||
+           strcmp(word, REDIRECT_HERE_DOCUMENT) == 0;
+}
+
+// This function replaces every pattern in the word list with the sorted list
+// of file names that it matches, updating *arrayElementsUsed. The words after
+// redirection symbols are left alone, since a redirection needs exactly one
+// file (or, for a here-string or here-document, is text, not a pattern). The
+// names themselves live in the arena, like the words that "$$" expansion
+// makes.
+static void expandGlobs
+(
+    struct wordList* wordList,
+    int* arrayElementsUsed,
+    struct wordArena* arena
+)
+{
+    struct globMatches matches = {NULL, 0, 0, NULL};
+    char path[PATH_MAX];
+
+    int i;
+    for (i = 0; i < *arrayElementsUsed; i++)
+    {
+        char* word = wordList->words[i];
+
+        if (hasWildcard(word, word + strlen(word)) == FALSE ||
+            (i > 0 && isRedirectionSymbol(wordList->words[i - 1]) == TRUE))
+        {
+            continue;
+        }
+
+        if (matches.buffer == NULL)
+        {
+            matches.buffer = malloc(GLOB_BUFFER_SIZE);
+            if (matches.buffer == NULL)
+            {
+                perror("Error when allocating memory for wildcards!");
+                exit(1);
+            }
+        }
+
+        matches.count = 0;
+        findGlobMatches(word, path, 0, &matches, arena);
+
+        if (matches.count == 0)
+        {
+            continue; // Nothing matched, so the word stays as it is.
+        }
+
+        // Sorting once, after everything has been found, is much cheaper than
+        // keeping the list in order as it grows:
+        qsort(matches.names, matches.count, sizeof(char*), compareFileNames);
+
+        // Make room for the matches in place of the pattern, and move the
+        // words after it (and the NULL) along:
+        int newCount = *arrayElementsUsed - 1 + matches.count;
+        if (makeRoomForWords(wordList, newCount) == FALSE)
+        {
+            break;
+        }
+        memmove(&wordList->words[i + matches.count], &wordList->words[i + 1],
+                (*arrayElementsUsed - i) * sizeof(char*));
+        memcpy(&wordList->words[i], matches.names,
+               matches.count * sizeof(char*));
+
+        *arrayElementsUsed = newCount;
+        i += matches.count - 1;
+    }
+
+    free(matches.names);
+    free(matches.buffer);
+
+    return;
+}
+
+// This function reaps every child that has finished, without waiting, and
+// reports the background processes among them:
+static void reapFinishedJobs(struct jobTable* jobTable)
+{
+    int childExitMethod;
+    pid_t processID;
+
+    while ((processID = waitpid(-1, &childExitMethod, WNOHANG)) > 0)
+    {
+        reportFinishedBackgroundProcess
+        (
+            processID,
+            childExitMethod,
+            jobTable,
+            FALSE
+        );
+    }
+
+    return;
+}
+
+// This function helps implemnent the "exit" built-in command. It needs to
+// terminate any background processes. Rather than killing and waiting for
+// them one at a time, we ask all of them to finish at once, with SIGTERM
+// (and SIGCONT, in case any are stopped), sent to each process group, so
+// that every stage of a pipeline gets it. That gives them a chance to clean
+// up, and they all do it at the same time. Then we reap them as they finish,
+// sleeping on the signalfd in between, until they're all gone or the grace
+// period (see gracePeriod()) is over. Whatever is left then gets SIGKILL.
+// So exiting takes at most about the grace period, no matter how many
+// processes there are. Each process is reported as usual, followed by a
+// summary. Queued commands (see queueBackgroundJob()) are never started.
+static void prepForExit(struct jobTable* jobTable, struct eventLoop* eventLoop)
+{
+    int discarded = discardQueuedJobs(jobTable);
+    if (discarded > 0)
+    {
+        char discardMessage[STATUS_REPORT_MAX_LENGTH];
+        sprintf(discardMessage, "%d queued background command%s never "
+                "started", discarded, (discarded == 1) ? "" : "s");
+        outputStringWithANewline(discardMessage);
+    }
+
+    int jobCount = jobTable->count;
+
+    if (jobCount == 0)
+    {
+        return;
+    }
+
+    long long startTime = monotonicNanoseconds();
+    long long deadline = startTime +
+                         (long long)(gracePeriod() * 1000000000.0);
+
+    struct job** jobs = listJobsInOrder(jobTable);
+    int i;
+    for (i = 0; i < jobCount; i++)
+    {
+        kill(-jobs[i]->processGroup, SIGTERM);
+        kill(-jobs[i]->processGroup, SIGCONT);
+    }
+    free(jobs);
+
+    struct pollfd watched;
+    watched.fd = eventLoop->signalFD;
+    watched.events = POLLIN;
+
+    reapFinishedJobs(jobTable);
+
+    while (jobTable->count > 0)
+    {
+        long long left = deadline - monotonicNanoseconds();
+        if (left <= 0)
+        {
+            break;
+        }
+
+        // Round up, so that we don't wake up just before the deadline. A
+        // SIGCHLD that arrives after the reaping and before the poll() is
+        // waiting in the signalfd, so we can't miss it.
+        poll(&watched, 1, (int)((left + 999999) / 1000000));
+        readSignals(eventLoop);
+        eventLoop->sigchldArrived = FALSE;
+
+        reapFinishedJobs(jobTable);
+    }
+
+    int killed = 0;
+
+    if (jobTable->count > 0)
+    {
+        // The grace period is over:
+        killed = jobTable->count;
+        jobs = listJobsInOrder(jobTable);
+        for (i = 0; i < killed; i++)
+        {
+            kill(-jobs[i]->processGroup, SIGKILL);
+        }
+        free(jobs);
+
+        // SIGKILL can't be ignored, so now we can simply wait:
+        while (jobTable->count > 0)
+        {
+            int childExitMethod;
+            pid_t processID = waitpid(-1, &childExitMethod, 0);
+
+            if (processID == -1)
+            {
+                // Somebody else already reaped them; all we can do is forget
+                // them. (forgetJob() moves other jobs around in the table,
+                // so we start over from the beginning after each one.)
+                while (jobTable->count > 0)
+                {
+                    for (i = 0; jobTable->slots[i].processID == 0; i++)
+                    {
+                    }
+                    forgetJob(jobTable, jobTable->slots[i].processID);
+                }
+                break;
+            }
+
+            reportFinishedBackgroundProcess
+            (
+                processID,
+                childExitMethod,
+                jobTable,
+                FALSE
+            );
+        }
+    }
+
+    // The stages of pipelines that ended along with their last stage:
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+    {
+    }
+
+    char summary[STATUS_REPORT_MAX_LENGTH];
+    sprintf
+    (
+        summary,
+        "%d background process%s stopped in %.2f s: %d within the grace "
+        "period, %d killed",
+        jobCount,
+        (jobCount == 1) ? "" : "es",
+        (monotonicNanoseconds() - startTime) / 1000000000.0,
+        jobCount - killed,
+        killed
+    );
+    outputStringWithANewline(summary);
+
+    return;
+}
+
+// This function writes a resource report as one line of text. The buffer
+// must have room for STATUS_REPORT_MAX_LENGTH characters.
+static void formatResourceReport(struct resourceReport* report, char* text)
+{
+    snprintf
+    (
+        text,
+        STATUS_REPORT_MAX_LENGTH,
+        "real %ld.%03lds user %ld.%03lds sys %ld.%03lds "
+        "maxrss %ldKB ctxsw %ld/%ld",
+        (long)report->elapsed.tv_sec,
+        report->elapsed.tv_nsec / 1000000,
+        (long)report->userTime.tv_sec,
+        (long)report->userTime.tv_usec / 1000,
+        (long)report->systemTime.tv_sec,
+        (long)report->systemTime.tv_usec / 1000,
+        report->maxResidentKilobytes,
+        report->voluntaryContextSwitches,
+        report->involuntaryContextSwitches
+    );
+
+    return;
+}
+
+// This function fills in the elapsed time of a resource report whose other
+// measurements are already there, given when the command started, and reports
+// it on stderr:
+static void finishResourceReport
+(
+    struct resourceReport* report,
+    struct timespec* startTime
+)
+{
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    report->elapsed.tv_sec = endTime.tv_sec - startTime->tv_sec;
+    report->elapsed.tv_nsec = endTime.tv_nsec - startTime->tv_nsec;
+    if (report->elapsed.tv_nsec < 0)
+    {
+        report->elapsed.tv_sec--;
+        report->elapsed.tv_nsec += 1000000000;
+    }
+    report->available = TRUE;
+
+    char text[STATUS_REPORT_MAX_LENGTH];
+    formatResourceReport(report, text);
+    fprintf(stderr, "%s\n", text);
+
+    return;
+}
+
+// This function implements the "time" built-in command when it's used on its
+// own (with a command, see runCommand()):
+static void outputResourceReport(struct resourceReport* report)
+{
+    if (report->available == FALSE)
+    {
+        outputStringWithANewline("time: the last command wasn't timed");
+        return;
+    }
+
+    char text[STATUS_REPORT_MAX_LENGTH];
+    formatResourceReport(report, text);
+    outputStringWithANewline(text);
+
+    return;
+}
+
+// This function implements the "status" built-in command. If the last
+// foreground command was timed, its resource report is output, too:
+static void outputStatus
+(
+    int statusType,
+    int statusValue,
+    struct resourceReport* report
+)
+{
+    if (statusType == EXIT_VALUE)
+    {
+        outputStringWithNoNewline("exit value ");
+    }
+    else
+    {
+        outputStringWithNoNewline("terminated by signal ");
+    }
+
+    char valueOrSignal[5];
+    sprintf(valueOrSignal, "%d", statusValue);
+    outputStringWithANewline(valueOrSignal);
+
+    if (report->available == TRUE)
+    {
+        outputResourceReport(report);
+    }
+
+    return;
+}
+
+// This function implements the "cd" built-in command:
+static void changeDirectory(char* parameter)
+{
+    const char* homePath = getenv("HOME");
+    // http://www0.cs.ucl.ac.uk/staff/W.Langdon/getenv/
+
+    if (strlen(parameter) == 0 || strcmp(parameter, "~") == 0)
+    // Strangely, chdir() wouldn't respond to having a "~" string as
+    // its parameter. It ignored it. In order to make "cd ~" work as
+    // expected, it is necessary to test the parameter for "~" and treat it
+    // as if the user entered just "cd".
+    {
+        chdir(homePath);
+    }
+    else
+    {
+        chdir(parameter);
+    }
+
+    return;
+}
+
+// This function computes which bucket of the command hash table a command
+// name belongs in. (This is the well-known "djb2" string hash.)
+static unsigned int hashCommandName(char* name)
+{
+    unsigned int hash = 5381;
+
+    while (*name != 0)
+    {
+        hash = hash * 33 + (unsigned char)*name;
+        name++;
+    }
+
+    return hash & (COMMAND_HASH_TABLE_SIZE - 1);
+}
+
+// This function forgets every remembered command location:
+static void clearCommandHashTable(struct commandHashTable* table)
+{
+    int i;
+    for (i = 0; i < COMMAND_HASH_TABLE_SIZE; i++)
+    {
+        struct hashedCommand* current = table->buckets[i];
+        while (current != NULL)
+        {
+            struct hashedCommand* next = current->next;
+            free(current->name);
+            free(current->path);
+            free(current);
+            current = next;
+        }
+        table->buckets[i] = NULL;
+    }
+
+    return;
+}
+
+// This function forgets where one command was found. Returns FALSE if we
+// didn't remember that command in the first place.
+static int forgetHashedCommand(struct commandHashTable* table, char* name)
+{
+    struct hashedCommand** link = &table->buckets[hashCommandName(name)];
+
+    while (*link != NULL)
+    {
+        if (strcmp((*link)->name, name) == 0)
+        {
+            struct hashedCommand* found = *link;
+            *link = found->next;
+            free(found->name);
+            free(found->path);
+            free(found);
+            return TRUE;
+        }
+        link = &(*link)->next;
+    }
+
+    return FALSE;
+}
+
+// Everything we remember was found using a particular value of PATH. If PATH
+// has changed since then, none of it can be trusted anymore, so this function
+// throws it all away:
+static void checkPathVariable(struct commandHashTable* table)
+{
+    char* pathVariable = getenv("PATH");
+    if (pathVariable == NULL)
+    {
+        pathVariable = DEFAULT_PATH;
+    }
+
+    if (table->pathVariable != NULL &&
+        strcmp(table->pathVariable, pathVariable) == 0)
+    {
+        return;
+    }
+
+    clearCommandHashTable(table);
+    free(table->pathVariable);
+    table->pathVariable = strdup(pathVariable);
+
+    return;
+}
+
+// This function searches the directories in PATH, in order, for an executable
+// file with the given name, the same way execvp() would. If it finds one, it
+// returns its full path (which the caller must free()); otherwise it returns
+// NULL. "*cacheable" is set to FALSE if the file was found through a relative
+// directory in PATH (such as "." or an empty entry), since what that refers
+// to changes whenever "cd" is used.
+static char* searchPath(char* pathVariable, char* name, int* cacheable)
+{
+    size_t nameLength = strlen(name);
+    char* directory = pathVariable;
+
+    while (TRUE)
+    {
+        char* end = strchr(directory, ':');
+        size_t directoryLength =
+            (end == NULL) ? strlen(directory) : (size_t)(end - directory);
+
+        char* candidate = malloc(directoryLength + nameLength + 3);
+        if (candidate == NULL)
+        {
+            perror("Error when allocating memory for a command path!");
+            exit(1);
+        }
+
+        // An empty entry in PATH means the current directory:
+        if (directoryLength == 0)
+        {
+            sprintf(candidate, "./%s", name);
+        }
+        else
+        {
+            memcpy(candidate, directory, directoryLength);
+            candidate[directoryLength] = '/';
+            strcpy(candidate + directoryLength + 1, name);
+        }
+
+        struct stat fileInfo;
+        if (stat(candidate, &fileInfo) == 0 &&
+            S_ISREG(fileInfo.st_mode) &&
+            access(candidate, X_OK) == 0)
+        {
+            *cacheable = (candidate[0] == '/');
+            return candidate;
+        }
+        free(candidate);
+
+        if (end == NULL)
+        {
+            return NULL;
+        }
+        directory = end + 1;
+    }
+}
+
+// This function returns the remembered location of the given command, or
+// NULL if we don't remember one:
+static struct hashedCommand* findHashedCommand
+(
+    struct commandHashTable* table,
+    char* name
+)
+{
+    struct hashedCommand* current = table->buckets[hashCommandName(name)];
+
+    while (current != NULL && strcmp(current->name, name) != 0)
+    {
+        current = current->next;
+    }
+
+    return current;
+}
+
+// This function returns the full path of the executable that should be run
+// for the given command name, or NULL if there isn't one. Names that contain
+// a "/" are used as they are, just like execvp() does. Otherwise we use the
+// location remembered in the hash table, searching PATH (and remembering the
+// result) only when we haven't seen the command before. The string returned
+// belongs to the table (or is the name itself) and must not be freed; it is
+// valid until the table is next changed.
+static char* lookUpCommand(struct commandHashTable* table, char* name)
+{
+    if (strchr(name, '/') != NULL)
+    {
+        return name;
+    }
+
+    checkPathVariable(table);
+
+    struct hashedCommand* found = findHashedCommand(table, name);
+    if (found != NULL)
+    {
+        found->hits++;
+        return found->path;
+    }
+
+    int cacheable = TRUE;
+    char* path = searchPath(table->pathVariable, name, &cacheable);
+
+    if (path == NULL)
+    {
+        return NULL;
+    }
+
+    if (cacheable == FALSE)
+    {
+        // We can't remember this one, but we still need to hand it back, so
+        // the table holds on to it until the next time this happens:
+        free(table->uncachedPath);
+        table->uncachedPath = path;
+        return path;
+    }
+
+    unsigned int bucket = hashCommandName(name);
+    struct hashedCommand* entry = malloc(sizeof(struct hashedCommand));
+    if (entry == NULL)
+    {
+        perror("Error when allocating memory for the command hash table!");
+        exit(1);
+    }
+    entry->name = strdup(name);
+    entry->path = path;
+    entry->hits = 1;
+    entry->next = table->buckets[bucket];
+    table->buckets[bucket] = entry;
+
+    return path;
+}
+
+// This function implements the "hash" built-in command:
+//   hash               lists every remembered command location
+//   hash -r            forgets all of them
+//   hash -d NAME...    forgets the given commands
+//   hash NAME...       looks up the given commands now, so that they're ready
+static void hashBuiltIn
+(
+    struct commandHashTable* table,
+    char** commandArray,
+    int arrayElementsUsed
+)
+{
+    char message[STATUS_REPORT_MAX_LENGTH];
+    int i;
+
+    checkPathVariable(table);
+
+    if (arrayElementsUsed == 1)
+    {
+        int listedAnything = FALSE;
+        for (i = 0; i < COMMAND_HASH_TABLE_SIZE; i++)
+        {
+            struct hashedCommand* current;
+            for (current = table->buckets[i];
+                 current != NULL;
+                 current = current->next)
+            {
+                if (listedAnything == FALSE)
+                {
+                    printf("hits\tcommand\n");
+                    listedAnything = TRUE;
+                }
+                printf("%4d\t%s\n", current->hits, current->path);
+            }
+        }
+        fflush(stdout);
+
+        if (listedAnything == FALSE)
+        {
+            outputStringWithANewline("hash: hash table empty");
+        }
+    }
+    else if (strcmp(commandArray[1], "-r") == 0)
+    {
+        clearCommandHashTable(table);
+    }
+    else if (strcmp(commandArray[1], "-d") == 0)
+    {
+        for (i = 2; i < arrayElementsUsed; i++)
+        {
+            if (forgetHashedCommand(table, commandArray[i]) == FALSE)
+            {
+                snprintf
+                (
+                    message,
+                    sizeof(message),
+                    "hash: %s: not found",
+                    commandArray[i]
+                );
+                outputStringWithANewline(message);
+            }
+        }
+    }
+    else
+    {
+        for (i = 1; i < arrayElementsUsed; i++)
+        {
+            // Names with a "/" in them aren't looked up in PATH, so there is
+            // nothing to remember for them.
+            if (strchr(commandArray[i], '/') != NULL ||
+                findHashedCommand(table, commandArray[i]) != NULL)
+            {
+                continue;
+            }
+
+            if (lookUpCommand(table, commandArray[i]) == NULL)
+            {
+                snprintf
+                (
+                    message,
+                    sizeof(message),
+                    "hash: %s: not found",
+                    commandArray[i]
+                );
+                outputStringWithANewline(message);
+                continue;
+            }
+
+            // Looking a command up ahead of time shouldn't count as using it:
+            struct hashedCommand* found =
+                findHashedCommand(table, commandArray[i]);
+            if (found != NULL)
+            {
+                found->hits = 0;
+            }
+        }
+    }
+
+    return;
+}
+
+// This function opens the files that a command's input and output should be
+// redirected to. It is done here in the shell, before the child exists, so
+// that both of the ways we have of starting a child (see below) only need to
+// move already-open files into place. The files are opened with O_CLOEXEC so
+// that only the copies placed on stdin and stdout survive into the command.
+// Returns FALSE (after reporting the problem) if a file couldn't be opened.
+static int openRedirectionFiles
+(
+    char* fileForInputRedirection,
+    char* fileForOutputRedirection,
+    int* inputFD,
+    int* outputFD
+)
+{
+    // Code for file redirection derived from professor's examples at:
+    // http://web.engr.oregonstate.edu/~brewsteb/CS344Slides/3.4%20More%20UNIX%20IO.pdf
+
+    if (fileForInputRedirection != NULL)
+    {
+        *inputFD = open(fileForInputRedirection, O_RDONLY | O_CLOEXEC);
+
+        if (*inputFD == -1) {
+            perror("Error when opening file for input redirection!");
+            return FALSE;
+        }
+    }
+
+    if (fileForOutputRedirection != NULL)
+    {
+        *outputFD = open
+        (
+            fileForOutputRedirection,
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644
+        );
+
+        if (*outputFD == -1) {
+            perror("Error when opening file for output redirection!");
+            if (*inputFD != -1)
+            {
+                close(*inputFD);
+                *inputFD = -1;
+            }
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// This function returns a file descriptor that reads "text" (followed by a
+// newline, if addNewline is TRUE), for a here-string or here-document,
+// without touching the filesystem. Text that fits in a pipe goes through one:
+// we write all of it now, before the command starts, and close our end, so
+// the command sees end-of-file after the text. Anything bigger would fill the
+// pipe before the command could start emptying it, so it goes into a memfd (a
+// file that only exists in memory) instead, which is sealed, so that nothing
+// can change it, and rewound. Returns -1 (after reporting the problem) if
+// neither works.
+static int openInputText(char* text, int addNewline)
+{
+    size_t textLength = strlen(text);
+    size_t length = textLength + ((addNewline == TRUE) ? 1 : 0);
+    int pipeEnds[2];
+
+    if (pipe2(pipeEnds, O_CLOEXEC) == 0)
+    {
+        int capacity = fcntl(pipeEnds[1], F_GETPIPE_SZ);
+
+        if (capacity != -1 && length <= (size_t) capacity &&
+            writeAll(pipeEnds[1], text, textLength) == TRUE &&
+            (addNewline == FALSE || writeAll(pipeEnds[1], "\n", 1) == TRUE))
+        {
+            close(pipeEnds[1]);
+            return pipeEnds[0];
+        }
+
+        close(pipeEnds[0]);
+        close(pipeEnds[1]);
+    }
+
+    int fd = memfd_create("smallsh-input", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd == -1 ||
+        writeAll(fd, text, textLength) == FALSE ||
+        (addNewline == TRUE && writeAll(fd, "\n", 1) == FALSE) ||
+        lseek(fd, 0, SEEK_SET) == -1)
+    {
+        perror("Error when setting up a here-document!");
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // (The command would still work without the seals, so we don't check
+    // whether they were added.)
+    fcntl(fd, F_ADD_SEALS,
+          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+
+    return fd;
+}
+
+// This function reads a list of CPUs like "0-3,6" (as taskset -c and the
+// files in /sys/devices/system/cpu use) into *cpus. Returns FALSE if "text"
+// isn't such a list.
+static int parseCPUList(char* text, cpu_set_t* cpus)
+{
+    CPU_ZERO(cpus);
+
+    while (TRUE)
+    {
+        char* end;
+        long first = strtol(text, &end, 10);
+        long last = first;
+
+        if (end == text || !isdigit((unsigned char) *text))
+        {
+            return FALSE;
+        }
+        if (*end == '-')
+        {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text || !isdigit((unsigned char) *text))
+            {
+                return FALSE;
+            }
+        }
+        if (last < first || last >= CPU_SETSIZE)
+        {
+            return FALSE;
+        }
+
+        long cpu;
+        for (cpu = first; cpu <= last; cpu++)
+        {
+            CPU_SET(cpu, cpus);
+        }
+
+        if (*end == 0)
+        {
+            return TRUE;
+        }
+        if (*end != ',')
+        {
+            return FALSE;
+        }
+        text = end + 1;
+    }
+}
+
+// This function reads an I/O scheduling class, "realtime", "best-effort", or
+// "idle" (or "rt" or "be"), optionally followed by a level from 0 (highest)
+// to 7, as in "best-effort:7", into the form that ioprio_set() takes. (The
+// idle class has no levels.) Returns FALSE if "text" isn't one of those.
+static int parseIOPriority(char* text, int* ioPriority)
+{
+    char* colon = strchr(text, ':');
+    size_t nameLength = (colon != NULL) ? (size_t)(colon - text) :
+                                          strlen(text);
+    int ioClass;
+    int level = DEFAULT_IO_PRIORITY_LEVEL;
+
+    if ((nameLength == 8 && strncmp(text, "realtime", 8) == 0) ||
+        (nameLength == 2 && strncmp(text, "rt", 2) == 0))
+    {
+        ioClass = IO_CLASS_REALTIME;
+    }
+    else if ((nameLength == 11 && strncmp(text, "best-effort", 11) == 0) ||
+             (nameLength == 2 && strncmp(text, "be", 2) == 0))
+    {
+        ioClass = IO_CLASS_BEST_EFFORT;
+    }
+    else if (nameLength == 4 && strncmp(text, "idle", 4) == 0 &&
+             colon == NULL)
+    {
+        ioClass = IO_CLASS_IDLE;
+        level = 0;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    if (colon != NULL)
+    {
+        char* end;
+        level = strtol(colon + 1, &end, 10);
+        if (end == colon + 1 || *end != 0 || level < 0 || level > 7)
+        {
+            return FALSE;
+        }
+    }
+
+    *ioPriority = (ioClass << IO_CLASS_SHIFT) | level;
+
+    return TRUE;
+}
+
+// This function reads a placement from the start of a list of words: a list
+// of CPUs (see parseCPUList()), "nice N", and "io CLASS" (see
+// parseIOPriority()), each optional and in any order, as in
+//   0-3 nice 10 io idle
+// It stops at the first word that isn't part of one of those, so that word
+// can be a command, even one named "nice" (as in "on 0-3 nice -n 10 make"),
+// or one whose name starts with a digit. A "--" also stops it (and is used
+// up), for a command that would otherwise look like part of a placement.
+// Returns how many words it used.
+static int parsePlacement
+(
+    char** words,
+    int wordCount,
+    struct placement* placement
+)
+{
+    cpu_set_t cpus;
+    int used = 0;
+
+    memset(placement, 0, sizeof(*placement));
+
+    while (used < wordCount)
+    {
+        char* word = words[used];
+        char* argument = (used + 1 < wordCount) ? words[used + 1] : NULL;
+
+        if (strcmp(word, "--") == 0)
+        {
+            return used + 1;
+        }
+        else if (strcmp(word, "nice") == 0 && argument != NULL)
+        {
+            char* end;
+            long niceness = strtol(argument, &end, 10);
+            if (end == argument || *end != 0 || niceness < -20 ||
+                niceness > 19)
+            {
+                break;
+            }
+            placement->hasNiceness = TRUE;
+            placement->niceness = niceness;
+            used += 2;
+        }
+        else if (strcmp(word, "io") == 0 && argument != NULL &&
+                 parseIOPriority(argument, &placement->ioPriority) == TRUE)
+        {
+            placement->hasIOPriority = TRUE;
+            used += 2;
+        }
+        else if (parseCPUList(word, &cpus) == TRUE)
+        {
+            placement->hasCPUs = TRUE;
+            placement->cpus = cpus;
+            used++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return used;
+}
+
+// This function returns TRUE if the placement doesn't change anything:
+static int placementIsEmpty(struct placement* placement)
+{
+    return placement->hasCPUs == FALSE &&
+           placement->hasNiceness == FALSE &&
+           placement->hasIOPriority == FALSE;
+}
+
+// This function puts whatever "from" sets into "into", leaving the rest of
+// "into" alone:
+static void mergePlacement(struct placement* into, struct placement* from)
+{
+    if (from->hasCPUs == TRUE)
+    {
+        into->hasCPUs = TRUE;
+        into->cpus = from->cpus;
+    }
+    if (from->hasNiceness == TRUE)
+    {
+        into->hasNiceness = TRUE;
+        into->niceness = from->niceness;
+    }
+    if (from->hasIOPriority == TRUE)
+    {
+        into->hasIOPriority = TRUE;
+        into->ioPriority = from->ioPriority;
+    }
+
+    return;
+}
+
+// This function outputs a placement the way that parsePlacement() reads it
+// (or "none"), followed by a newline:
+static void outputPlacement(struct placement* placement)
+{
+    if (placementIsEmpty(placement) == TRUE)
+    {
+        printf("none\n");
+        return;
+    }
+
+    char* separator = "";
+
+    if (placement->hasCPUs == TRUE)
+    {
+        // Each run of CPUs in a row is output as a range:
+        int cpu = 0;
+        while (cpu < CPU_SETSIZE)
+        {
+            if (CPU_ISSET(cpu, &placement->cpus) == 0)
+            {
+                cpu++;
+                continue;
+            }
+
+            int last = cpu;
+            while (last + 1 < CPU_SETSIZE &&
+                   CPU_ISSET(last + 1, &placement->cpus) != 0)
+            {
+                last++;
+            }
+
+            printf((last == cpu) ? "%s%d" : "%s%d-%d", separator, cpu, last);
+            separator = ",";
+            cpu = last + 1;
+        }
+        separator = " ";
+    }
+
+    if (placement->hasNiceness == TRUE)
+    {
+        printf("%snice %d", separator, placement->niceness);
+        separator = " ";
+    }
+
+    if (placement->hasIOPriority == TRUE)
+    {
+        int ioClass = placement->ioPriority >> IO_CLASS_SHIFT;
+        int level = placement->ioPriority & ((1 << IO_CLASS_SHIFT) - 1);
+
+        if (ioClass == IO_CLASS_IDLE)
+        {
+            printf("%sio idle", separator);
+        }
+        else
+        {
+            printf("%sio %s:%d", separator,
+                   (ioClass == IO_CLASS_REALTIME) ? "realtime" : "best-effort",
+                   level);
+        }
+    }
+
+    printf("\n");
+
+    return;
+}
+
+// This function implements the "admit" built-in command:
+//     admit                                        show the admission policy
+//     admit [jobs N] [load LOAD] [pressure PERCENT]    change it
+//     admit off                                    remove every limit
+// (see struct admissionPolicy; 0 means no limit). Commands that are already
+// queued are started right away if the new policy lets them.
+static void admitBuiltIn
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct jobTable* jobTable,
+    int* statusType,
+    int* statusValue
+)
+{
+    struct admissionPolicy policy = jobTable->admission;
+    int i;
+
+    *statusType = EXIT_VALUE;
+    *statusValue = 1;
+
+    if (arrayElementsUsed == 1)
+    {
+        char jobsLimit[32] = "none";
+        char loadLimit[32] = "none";
+        char pressureLimit[32] = "none";
+
+        if (policy.maximumJobs > 0)
+        {
+            sprintf(jobsLimit, "%d", policy.maximumJobs);
+        }
+        if (policy.maximumLoad > 0)
+        {
+            sprintf(loadLimit, "%.2f", policy.maximumLoad);
+        }
+        if (policy.maximumPressure > 0)
+        {
+            sprintf(pressureLimit, "%.2f%%", policy.maximumPressure);
+        }
+
+        printf("admit: jobs %s, load %s, pressure %s; %d running, %d "
+               "queued\n", jobsLimit, loadLimit, pressureLimit,
+               jobTable->count, jobTable->queuedCount);
+        fflush(stdout);
+
+        *statusValue = 0;
+        return;
+    }
+
+    if (arrayElementsUsed == 2 && strcmp(commandArray[1], "off") == 0)
+    {
+        memset(&policy, 0, sizeof(policy));
+    }
+    else if (arrayElementsUsed % 2 == 0)
+    {
+        fprintf(stderr, "admit: usage: admit [jobs N] [load LOAD] "
+                "[pressure PERCENT] (or off)\n");
+        return;
+    }
+
+    for (i = 1; i + 1 < arrayElementsUsed; i += 2)
+    {
+        char* end;
+        double limit = strtod(commandArray[i + 1], &end);
+
+        if (*end != 0 || end == commandArray[i + 1] || limit < 0)
+        {
+            fprintf(stderr, "admit: %s: invalid limit\n", commandArray[i + 1]);
+            return;
+        }
+
+        if (strcmp(commandArray[i], "jobs") == 0)
+        {
+            if (limit > INT_MAX || limit != (int) limit)
+            {
+                fprintf(stderr, "admit: jobs needs a whole number\n");
+                return;
+            }
+            policy.maximumJobs = (int) limit;
+        }
+        else if (strcmp(commandArray[i], "load") == 0)
+        {
+            policy.maximumLoad = limit;
+        }
+        else if (strcmp(commandArray[i], "pressure") == 0)
+        {
+            if (limit > 0 && readProcNumber(CPU_PRESSURE_FILE, "avg60=") < 0)
+            {
+                fprintf(stderr, "admit: %s can't be read (it is new in "
+                        "Linux 4.20)\n", CPU_PRESSURE_FILE);
+                return;
+            }
+            policy.maximumPressure = limit;
+        }
+        else
+        {
+            fprintf(stderr, "admit: %s isn't jobs, load, or pressure\n",
+                    commandArray[i]);
+            return;
+        }
+    }
+
+    jobTable->admission = policy;
+    *statusValue = 0;
+
+    startQueuedJobs(jobTable);
+
+    return;
+}
+
+// This function implements the "placement" built-in command:
+//     placement                                  show both defaults
+//     placement foreground|background [ITEMS]   set (or, without ITEMS,
+//                                                 clear) one of them
+// ITEMS are as for parsePlacement(). Every command started after that in the
+// foreground (or background) gets that placement, unless "on" says
+// otherwise.
+static void placementBuiltIn
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct placementSettings* placements,
+    int* statusType,
+    int* statusValue
+)
+{
+    *statusType = EXIT_VALUE;
+    *statusValue = 1;
+
+    if (arrayElementsUsed == 1)
+    {
+        printf("foreground: ");
+        outputPlacement(&placements->foreground);
+        printf("background: ");
+        outputPlacement(&placements->background);
+        fflush(stdout);
+
+        *statusValue = 0;
+        return;
+    }
+
+    struct placement* which = NULL;
+    if (strcmp(commandArray[1], "foreground") == 0)
+    {
+        which = &placements->foreground;
+    }
+    else if (strcmp(commandArray[1], "background") == 0)
+    {
+        which = &placements->background;
+    }
+
+    if (which == NULL)
+    {
+        fprintf(stderr, "placement: usage: placement [foreground|background "
+                "[CPUS] [nice N] [io CLASS]]\n");
+        return;
+    }
+
+    struct placement placement;
+    int used = parsePlacement
+    (
+        commandArray + 2,
+        arrayElementsUsed - 2,
+        &placement
+    );
+
+    if (used < arrayElementsUsed - 2)
+    {
+        fprintf(stderr, "placement: can't use \"%s\" (ITEMS are a list of "
+                "CPUS like 0-3,6, nice N from -20 to 19, and io CLASS, where "
+                "CLASS is realtime, best-effort, or idle, with :0 to :7 for "
+                "a level)\n", commandArray[2 + used]);
+        return;
+    }
+
+    *which = placement;
+    *statusValue = 0;
+
+    return;
+}
+
+// This function applies a placement to the calling process. It is called in
+// a new child, just before it execs the command. If part of it can't be
+// applied (for example, because only root can lower niceness), that is
+// reported, and the command still runs, as with nice(1).
+static void applyPlacement(struct placement* placement)
+{
+    if (placement->hasCPUs == TRUE &&
+        sched_setaffinity(0, sizeof(cpu_set_t), &placement->cpus) == -1)
+    {
+        perror("Error when setting the CPUs for a command!");
+    }
+
+    if (placement->hasNiceness == TRUE &&
+        setpriority(PRIO_PROCESS, 0, placement->niceness) == -1)
+    {
+        perror("Error when setting the niceness of a command!");
+    }
+
+    if (placement->hasIOPriority == TRUE &&
+        syscall(SYS_ioprio_set, IO_PRIORITY_WHO_PROCESS, 0,
+                placement->ioPriority) == -1)
+    {
+        perror("Error when setting the I/O priority of a command!");
+    }
+
+    return;
+}
+
+// This function does everything that a child process has to do before it
+// becomes the command: it joins its process group (if processGroup isn't -1),
+// applies its placement (if placement isn't NULL; see struct placement),
+// moves inputFD, outputFD, and errorFD (if they aren't -1) onto stdin,
+// stdout, and stderr, sets up its signals, and finally execs the command. It
+// never returns. It is shared by spawnWithFork() and the zygote (see
+// runZygote()). If traceFD isn't -1, the time just before exec is written to
+// it.
+static void setUpChildAndExec
+(
+    char** commandArray,
+    char* executablePath,
+    int inputFD,
+    int outputFD,
+    int errorFD,
+    int actuallyRunInBackground,
+    pid_t processGroup,
+    struct placement* placement,
+    struct sigaction* originalSigintAction,
+    int traceFD
+)
+{
+    if (processGroup != -1)
+    {
+        setpgid(0, processGroup);
+    }
+
+    if (placement != NULL)
+    {
+        applyPlacement(placement);
+    }
+
+    // Now actually set up input redirection, if necessary:
+    if (inputFD != -1)
+    {
+        int result = dup2(inputFD, 0);
+
+        if (result == -1)
+        {
+            perror("Error when initiating input redirection!");
+            exit(1);
+        }
+    }
+
+    // And actualy set up output redirection, if necessary:
+    if (outputFD != -1)
+    {
+        int result = dup2(outputFD, 1);
+
+        if (result == -1)
+        {
+            perror("Error when initiating output redirection!");
+            exit(1);
+        }
+    }
+
+    // Background commands whose output is captured (see struct jobLog) also
+    // have their stderr redirected:
+    if (errorFD != -1)
+    {
+        int result = dup2(errorFD, 2);
+
+        if (result == -1)
+        {
+            perror("Error when initiating error redirection!");
+            exit(1);
+        }
+    }
+
+    // If the command is going to be run in the _foreground_, we need to
+    // set sigaction(SIGINT) back to its original behavior (the behavior
+    // it had before we set things to ignore SIGINT):
+
+    if (actuallyRunInBackground == FALSE)
+    {
+        sigaction(SIGINT, originalSigintAction, NULL);
+    }
+
+    // Whether this is going to be a foreground process or a background
+    // process--either way--it needs to ignore SIGTSTP. The shell already
+    // ignores it, and that carries over.
+
+    // The shell blocks SIGCHLD, SIGTSTP, and SIGINT, but the command
+    // shouldn't:
+
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    sigprocmask(SIG_SETMASK, &emptyMask, NULL);
+
+    // And finally we're ready to execvp():
+
+    // Pattern for execvp() comes from instructor at:
+    // http://web.engr.oregonstate.edu/~brewsteb/CS344Slides/3.1%20Processes.pdf
+
+    // In trace mode, we tell the shell when we got here. (The pipe is
+    // O_CLOEXEC, so exec closes it.)
+    if (traceFD != -1)
+    {
+        long long now = monotonicNanoseconds();
+        write(traceFD, &now, sizeof(now));
+    }
+
+    execv(executablePath, commandArray);
+
+    // If the file we remembered for this command has gone away, the
+    // command may still be somewhere else in PATH:
+    if (errno == ENOENT && executablePath != commandArray[0])
+    {
+        execvp(*commandArray, commandArray);
+    }
+
+    perror("Error when attempting to execute command!");
+    exit(1);
+}
+
+// In trace mode, a child that we start with fork() (or that the zygote starts)
+// tells us when it is about to exec through a pipe. This function makes the
+// pipe, if execTime isn't NULL. The write end is for the child.
+static void openTracePipe(long long* execTime, int tracePipe[2])
+{
+    tracePipe[0] = -1;
+    tracePipe[1] = -1;
+
+    if (execTime != NULL && pipe2(tracePipe, O_CLOEXEC) == -1)
+    {
+        tracePipe[0] = -1;
+        tracePipe[1] = -1;
+    }
+
+    return;
+}
+
+// This function closes our copy of the write end of the pipe, and then reads
+// the time from it. (If the child never got as far as exec, there's nothing
+// to read, and *execTime stays 0.)
+static void readTracePipe(long long* execTime, int tracePipe[2])
+{
+    if (tracePipe[0] == -1)
+    {
+        return;
+    }
+
+    close(tracePipe[1]);
+    *execTime = 0;
+    while (read(tracePipe[0], execTime, sizeof(*execTime)) == -1 &&
+           errno == EINTR)
+    {
+        // Try again.
+    }
+    close(tracePipe[0]);
+
+    return;
+}
+
+// This function starts a command the traditional way, with fork() and
+// execv(). It is used when USE_POSIX_SPAWN is FALSE, and as a fallback for
+// the function below. If processGroup isn't -1, the child is put in that
+// process group (0 means a new group, named after the child's own pid). If
+// placement isn't NULL, the child applies it (see applyPlacement()). If
+// execTime isn't NULL, it is set to the time just before the child's exec.
+// Returns the child's pid (in the parent), or -1 with errno set if fork()
+// failed.
+static pid_t spawnWithFork
+(
+    char** commandArray,
+    char* executablePath,
+    int inputFD,
+    int outputFD,
+    int errorFD,
+    int actuallyRunInBackground,
+    pid_t processGroup,
+    struct placement* placement,
+    struct sigaction* originalSigintAction,
+    long long* execTime
+)
+{
+    int tracePipe[2];
+    openTracePipe(execTime, tracePipe);
+
+    // Template for forking comes from instructor at:
+    // http://web.engr.oregonstate.edu/~brewsteb/CS344Slides/3.1%20Processes.pdf
+
+    pid_t spawnPid = -5;
+ 
+    spawnPid = fork();
+ 
+    if (spawnPid == -1) //  Error!
+    {
+        int forkError = errno;
+        readTracePipe(execTime, tracePipe); // Just closes it.
+        errno = forkError;
+        return -1; // spawnCommand() reports it.
+    }
+    else if (spawnPid == 0) // We are in the child process!
+    {
+        setUpChildAndExec
+        (
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            originalSigintAction,
+            tracePipe[1]
+        );
+    }
+
+    readTracePipe(execTime, tracePipe);
+
+    // The child joins its process group itself, but it might not have gotten
+    // that far before someone tries to signal the group, so we do it here,
+    // too. (Whichever of us is second just gets an error, which is fine.)
+    if (processGroup != -1)
+    {
+        setpgid(spawnPid, (processGroup == 0) ? spawnPid : processGroup);
+    }
+
+    return spawnPid;
+}
+
+// This function starts a command with posix_spawn(). glibc implements that
+// with clone(CLONE_VM | CLONE_VFORK), so unlike fork() it never has to copy
+// the shell's page tables, however large the shell has grown. Everything the
+// child needs to do before exec is described up front instead of being done
+// by our own code in the child:
+//   - stdin, stdout, and stderr are moved into place with "file actions",
+//     and
+//   - SIGINT is reset to its original behavior (for foreground commands) with
+//     the "signal default" attribute.
+// The child also needs to ignore SIGTSTP. There is no attribute for that, but
+// none is needed: the shell itself ignores SIGTSTP (see struct eventLoop), and
+// an ignored signal stays ignored across exec.
+// processGroup works the same way as for spawnWithFork(). posix_spawn() only
+// returns once the child has exec'd, so that is when *execTime (if execTime
+// isn't NULL) is set. Returns the child's pid, or -1 with errno set.
+//
+// posix_spawn() has no attributes for CPU affinity, niceness, or I/O
+// priority, so commands with a placement are handed to spawnWithFork()
+// instead.
+static pid_t spawnWithPosixSpawn
+(
+    char** commandArray,
+    char* executablePath,
+    int inputFD,
+    int outputFD,
+    int errorFD,
+    int actuallyRunInBackground,
+    pid_t processGroup,
+    struct placement* placement,
+    struct sigaction* originalSigintAction,
+    long long* execTime
+)
+{
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attributes;
+
+    if (placement != NULL ||
+        posix_spawn_file_actions_init(&fileActions) != 0)
+    {
+        return spawnWithFork
+        (
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            originalSigintAction,
+            execTime
+        );
+    }
+    if (posix_spawnattr_init(&attributes) != 0)
+    {
+        posix_spawn_file_actions_destroy(&fileActions);
+        return spawnWithFork
+        (
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            originalSigintAction,
+            execTime
+        );
+    }
+
+    if (inputFD != -1)
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, inputFD, 0);
+    }
+    if (outputFD != -1)
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, outputFD, 1);
+    }
+    if (errorFD != -1)
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, errorFD, 2);
+    }
+
+    // Foreground commands get SIGINT back (if the shell was started with it
+    // at its default behavior); background commands keep ignoring it, just
+    // like the shell does:
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    if (actuallyRunInBackground == FALSE &&
+        originalSigintAction->sa_handler == SIG_DFL)
+    {
+        sigaddset(&defaultSignals, SIGINT);
+    }
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+
+    // The child shouldn't inherit the signals that the shell blocks:
+    sigset_t childMask;
+    sigemptyset(&childMask);
+    posix_spawnattr_setsigmask(&attributes, &childMask);
+
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    if (processGroup != -1)
+    {
+        posix_spawnattr_setpgroup(&attributes, processGroup);
+        flags |= POSIX_SPAWN_SETPGROUP;
+    }
+
+    posix_spawnattr_setflags(&attributes, flags);
+
+    pid_t spawnPid = -1;
+    int result = posix_spawn
+    (
+        &spawnPid,
+        executablePath,
+        &fileActions,
+        &attributes,
+        commandArray,
+        environ
+    );
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&fileActions);
+
+    if (result != 0)
+    {
+        // posix_spawn() reports failures (including exec failures in the
+        // child) through its return value rather than through errno:
+        errno = result;
+        return -1;
+    }
+
+    if (execTime != NULL)
+    {
+        *execTime = monotonicNanoseconds();
+    }
+
+    return spawnPid;
+}
+
+// This function closes whichever of the given file descriptors are open:
+static void closeIfOpen(int* fileDescriptors, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        if (fileDescriptors[i] != -1)
+        {
+            close(fileDescriptors[i]);
+            fileDescriptors[i] = -1;
+        }
+    }
+
+    return;
+}
+
+// The next few functions implement "zygote mode" (smallsh -z). At startup,
+// before the shell has grown at all, we fork a small helper process, the
+// zygote, and from then on it starts commands for us: we send it a request
+// over a Unix socket, and it clones itself (which is cheap, since it is
+// tiny) and the clone becomes the command. The clone is made with
+// CLONE_PARENT, so the command is the shell's own child, not the zygote's, and
+// waiting for it works exactly as it does for the other spawn functions.
+
+// This function reads exactly "size" bytes from a socket. Returns FALSE if
+// the other end went away first.
+static int receiveExactly(int socketFD, void* buffer, size_t size)
+{
+    char* next = buffer;
+
+    while (size > 0)
+    {
+        ssize_t bytesRead = read(socketFD, next, size);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead <= 0)
+        {
+            return FALSE;
+        }
+        next += bytesRead;
+        size -= bytesRead;
+    }
+
+    return TRUE;
+}
+
+// This function is the zygote's main loop. It never returns: when the shell
+// closes its end of the socket (or dies), the zygote exits.
+static void runZygote(int socketFD)
+{
+    // Die along with the shell, even if it is killed before it can close the
+    // socket:
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+    // Like the shell, we ignore SIGINT and SIGTSTP, but we remember what
+    // SIGINT originally did, for foreground commands:
+    struct sigaction ignoreAction = {{0}};
+    struct sigaction originalSigintAction = {{0}};
+    ignoreAction.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &ignoreAction, &originalSigintAction);
+    sigaction(SIGTSTP, &ignoreAction, NULL);
+
+    while (TRUE)
+    {
+        struct zygoteRequest request;
+        char controlBuffer[CMSG_SPACE(sizeof(int) * 5)];
+        struct iovec requestPart = {&request, sizeof(request)};
+        struct msghdr message = {0};
+
+        message.msg_iov = &requestPart;
+        message.msg_iovlen = 1;
+        message.msg_control = controlBuffer;
+        message.msg_controllen = sizeof(controlBuffer);
+
+        // The file descriptors come along with the first byte of the request:
+        ssize_t bytesRead = recvmsg(socketFD, &message, MSG_CMSG_CLOEXEC);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead <= 0 ||
+            receiveExactly
+            (
+                socketFD,
+                (char*)&request + bytesRead,
+                sizeof(request) - bytesRead
+            ) == FALSE)
+        {
+            _exit(0);
+        }
+
+        int receivedFDs[5] = {-1, -1, -1, -1, -1};
+        struct cmsghdr* control = CMSG_FIRSTHDR(&message);
+        if (control != NULL && control->cmsg_type == SCM_RIGHTS)
+        {
+            int fdCount = (control->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(receivedFDs, CMSG_DATA(control), fdCount * sizeof(int));
+        }
+
+        int next = 0;
+        int inputFD = (request.hasInputFD == TRUE) ? receivedFDs[next++] : -1;
+        int outputFD =
+            (request.hasOutputFD == TRUE) ? receivedFDs[next++] : -1;
+        int errorFD = (request.hasErrorFD == TRUE) ? receivedFDs[next++] : -1;
+        int directoryFD =
+            (request.hasDirectoryFD == TRUE) ? receivedFDs[next++] : -1;
+        int traceFD = (request.hasTraceFD == TRUE) ? receivedFDs[next++] : -1;
+
+        // Then come the executable's path and the words of the command, one
+        // after another, each ending in a \0:
+        char* text = malloc(request.textLength);
+        char** commandArray = malloc((request.wordCount + 1) * sizeof(char*));
+        if (text == NULL || commandArray == NULL ||
+            receiveExactly(socketFD, text, request.textLength) == FALSE)
+        {
+            _exit(1);
+        }
+
+        char* executablePath = text;
+        char* word = text + strlen(text) + 1;
+        int i;
+        for (i = 0; i < request.wordCount; i++)
+        {
+            commandArray[i] = word;
+            word += strlen(word) + 1;
+        }
+        commandArray[i] = NULL;
+
+        struct zygoteReply reply;
+
+        // This is fork(), except that the new process's parent is the shell:
+        reply.processID = syscall
+        (
+            SYS_clone,
+            CLONE_PARENT | SIGCHLD,
+            NULL,
+            NULL,
+            NULL,
+            NULL
+        );
+        reply.error = errno;
+
+        if (reply.processID == 0)
+        {
+            if (directoryFD != -1)
+            {
+                fchdir(directoryFD);
+            }
+            setUpChildAndExec
+            (
+                commandArray,
+                executablePath,
+                inputFD,
+                outputFD,
+                errorFD,
+                request.actuallyRunInBackground,
+                request.processGroup,
+                (request.hasPlacement == TRUE) ? &request.placement : NULL,
+                &originalSigintAction,
+                traceFD
+            );
+        }
+
+        write(socketFD, &reply, sizeof(reply));
+
+        closeIfOpen(receivedFDs, 5);
+        free(commandArray);
+        free(text);
+    }
+}
+
+// This function starts the zygote. If it can't, zygote->socketFD is left at
+// -1 and commands are started the usual way.
+static void startZygote(struct zygote* zygote)
+{
+    int socketFDs[2];
+
+    zygote->socketFD = -1;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socketFDs) == -1)
+    {
+        perror("Error when creating the zygote's socket!");
+        return;
+    }
+
+    pid_t shellPid = getpid();
+    zygote->processID = fork();
+
+    if (zygote->processID == -1)
+    {
+        perror("Error when starting the zygote!");
+        close(socketFDs[0]);
+        close(socketFDs[1]);
+        return;
+    }
+    else if (zygote->processID == 0)
+    {
+        close(socketFDs[0]);
+        if (getppid() != shellPid)
+        {
+            _exit(0); // The shell is already gone.
+        }
+        runZygote(socketFDs[1]);
+    }
+
+    close(socketFDs[1]);
+    zygote->socketFD = socketFDs[0];
+
+    return;
+}
+
+// This function stops using the zygote (because talking to it failed):
+static void stopZygote(struct zygote* zygote)
+{
+    perror("Error when talking to the zygote! Not using it any more");
+    close(zygote->socketFD);
+    zygote->socketFD = -1;
+    kill(zygote->processID, SIGKILL);
+
+    return;
+}
+
+// This function starts a command by asking the zygote to do it. The arguments
+// are the same as for the other spawn functions, except that our current
+// directory is sent along, too (the zygote stays wherever we were when it
+// started). The exec happens in the new process, after it has been given its
+// pid, so a command that can't be run shows up as one that exited with 1, as
+// with spawnWithFork(). placement and execTime work as they do for
+// spawnWithFork(), too.
+// Returns the child's pid, or -1 with errno set.
+static pid_t spawnWithZygote
+(
+    struct zygote* zygote,
+    char** commandArray,
+    char* executablePath,
+    int inputFD,
+    int outputFD,
+    int errorFD,
+    int actuallyRunInBackground,
+    pid_t processGroup,
+    struct placement* placement,
+    long long* execTime
+)
+{
+    struct zygoteRequest request;
+    int fdsToSend[5];
+    int fdCount = 0;
+
+    request.actuallyRunInBackground = actuallyRunInBackground;
+    request.processGroup = processGroup;
+    request.hasInputFD = (inputFD != -1);
+    request.hasOutputFD = (outputFD != -1);
+    request.hasErrorFD = (errorFD != -1);
+    request.hasPlacement = (placement != NULL);
+    if (placement != NULL)
+    {
+        request.placement = *placement;
+    }
+    if (inputFD != -1)
+    {
+        fdsToSend[fdCount++] = inputFD;
+    }
+    if (outputFD != -1)
+    {
+        fdsToSend[fdCount++] = outputFD;
+    }
+    if (errorFD != -1)
+    {
+        fdsToSend[fdCount++] = errorFD;
+    }
+
+    int directoryFD = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    request.hasDirectoryFD = (directoryFD != -1);
+    if (directoryFD != -1)
+    {
+        fdsToSend[fdCount++] = directoryFD;
+    }
+
+    int tracePipe[2];
+    openTracePipe(execTime, tracePipe);
+    request.hasTraceFD = (tracePipe[1] != -1);
+    if (tracePipe[1] != -1)
+    {
+        fdsToSend[fdCount++] = tracePipe[1];
+    }
+
+    // The text that goes along with the request is the executable's path
+    // and then the words, each ending in a \0:
+    request.wordCount = 0;
+    request.textLength = strlen(executablePath) + 1;
+    while (commandArray[request.wordCount] != NULL)
+    {
+        request.textLength += strlen(commandArray[request.wordCount]) + 1;
+        request.wordCount++;
+    }
+
+    // The request and the text are sent as one message:
+    size_t messageLength = sizeof(request) + request.textLength;
+    char* messageBuffer = malloc(messageLength);
+    if (messageBuffer == NULL)
+    {
+        perror("Error when allocating memory for a command!");
+        exit(1);
+    }
+
+    memcpy(messageBuffer, &request, sizeof(request));
+    char* next = stpcpy(messageBuffer + sizeof(request), executablePath) + 1;
+    int i;
+    for (i = 0; i < request.wordCount; i++)
+    {
+        next = stpcpy(next, commandArray[i]) + 1;
+    }
+
+    struct iovec messagePart = {messageBuffer, messageLength};
+    char controlBuffer[CMSG_SPACE(sizeof(int) * 5)] = {0};
+    struct msghdr message = {0};
+
+    message.msg_iov = &messagePart;
+    message.msg_iovlen = 1;
+
+    if (fdCount > 0)
+    {
+        message.msg_control = controlBuffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fdCount);
+
+        struct cmsghdr* control = CMSG_FIRSTHDR(&message);
+        control->cmsg_level = SOL_SOCKET;
+        control->cmsg_type = SCM_RIGHTS;
+        control->cmsg_len = CMSG_LEN(sizeof(int) * fdCount);
+        memcpy(CMSG_DATA(control), fdsToSend, sizeof(int) * fdCount);
+    }
+
+    ssize_t bytesSent = sendmsg(zygote->socketFD, &message, MSG_NOSIGNAL);
+
+    // A long command may not all fit in the socket at once; the rest is sent
+    // without the file descriptors:
+    while (bytesSent != -1 && (size_t) bytesSent < messageLength)
+    {
+        ssize_t more = send
+        (
+            zygote->socketFD,
+            messageBuffer + bytesSent,
+            messageLength - bytesSent,
+            MSG_NOSIGNAL
+        );
+        bytesSent = (more == -1) ? -1 : bytesSent + more;
+    }
+
+    free(messageBuffer);
+    if (directoryFD != -1)
+    {
+        close(directoryFD);
+    }
+
+    struct zygoteReply reply;
+
+    if (bytesSent == -1 ||
+        receiveExactly(zygote->socketFD, &reply, sizeof(reply)) == FALSE)
+    {
+        int tracePipeEnds[2] = {tracePipe[0], tracePipe[1]};
+        closeIfOpen(tracePipeEnds, 2);
+        stopZygote(zygote);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    readTracePipe(execTime, tracePipe);
+
+    if (reply.processID == -1)
+    {
+        errno = reply.error;
+        return -1;
+    }
+
+    // As with spawnWithFork(), we make sure the child is in its process group
+    // before anyone can signal it (we can do that, since it is our child):
+    if (processGroup != -1)
+    {
+        setpgid
+        (
+            reply.processID,
+            (processGroup == 0) ? reply.processID : processGroup
+        );
+    }
+
+    return reply.processID;
+}
+
+// This function joins words back together, with a space between each pair,
+// into a newly allocated string (which the caller must free()):
+static char* joinWords(char** words, int wordCount)
+{
+    size_t length = 1;
+    int i;
+
+    for (i = 0; i < wordCount; i++)
+    {
+        length += strlen(words[i]) + 1;
+    }
+
+    char* joined = malloc(length);
+    char* end = joined;
+    *end = 0;
+
+    for (i = 0; i < wordCount; i++)
+    {
+        if (i > 0)
+        {
+            *end = ' ';
+            end++;
+        }
+        size_t wordLength = strlen(words[i]);
+        memcpy(end, words[i], wordLength + 1);
+        end += wordLength;
+    }
+
+    return joined;
+}
+
+// This function notes a redirection, if "symbol" is one, of the stage's input
+// or output to "word". Returns FALSE if "symbol" isn't a redirection symbol.
+static int noteRedirection
+(
+    struct pipelineStage* stage,
+    char* symbol,
+    char* word
+)
+{
+    if (strcmp(symbol, REDIRECT_OUTPUT) == 0)
+    {
+        stage->fileForOutputRedirection = word;
+        return TRUE;
+    }
+
+    // Input can only come from one place. findRedirections() works back from
+    // the end of the command, so (as has always been the case for two <s)
+    // the leftmost one wins:
+    if (strcmp(symbol, REDIRECT_INPUT) == 0)
+    {
+        stage->fileForInputRedirection = word;
+        stage->textForInput = NULL;
+    }
+    else if (strcmp(symbol, REDIRECT_HERE_STRING) == 0)
+    {
+        stage->fileForInputRedirection = NULL;
+        stage->textForInput = word;
+        stage->textNeedsNewline = TRUE;
+    }
+    else if (strcmp(symbol, REDIRECT_HERE_DOCUMENT) == 0)
+    {
+        // (By now, the word is the here-document's text.)
+        stage->fileForInputRedirection = NULL;
+        stage->textForInput = word;
+        stage->textNeedsNewline = FALSE;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// This function looks at the end of one pipeline stage's command array to see
+// if there is a need for input/output redirection. If there is, it notes the
+// files (or text) and cuts the redirection symbols and files off of the
+// array, which it leaves ending in a NULL so that it's ready for exec.
+static void findRedirections(struct pipelineStage* stage)
+{
+    char** commandArray = stage->commandArray;
+    int arrayElementsUsed = stage->arrayElementsUsed;
+
+    stage->fileForInputRedirection = NULL;
+    stage->fileForOutputRedirection = NULL;
+    stage->textForInput = NULL;
+    stage->textNeedsNewline = FALSE;
+
+    // Check the last two arguments to see if we might be redirecting input or
+    // output. (We need at least three words for that: the command, the
+    // redirection symbol, and the file.) If they do indicate redirection,
+    // then we also need to check the two elements before them:
+
+    if
+    (
+        arrayElementsUsed >= 3 &&
+        noteRedirection
+        (
+            stage,
+            commandArray[arrayElementsUsed - 2],
+            commandArray[arrayElementsUsed - 1]
+        ) == TRUE
+    )
+    {
+        arrayElementsUsed = arrayElementsUsed - 2;
+
+        if
+        (
+            arrayElementsUsed >= 3 &&
+            noteRedirection
+            (
+                stage,
+                commandArray[arrayElementsUsed - 2],
+                commandArray[arrayElementsUsed - 1]
+            ) == TRUE
+        )
+        {
+            arrayElementsUsed = arrayElementsUsed - 2;
+        }
+    }
+
+    // The array is already in a form that we can send to exec; we just need
+    // to cut it off before the redirection symbols:
+
+    commandArray[arrayElementsUsed] = NULL;
+    stage->arrayElementsUsed = arrayElementsUsed;
+
+    return;
+}
+
+// This function checks that a command's words will fit in the space that the
+// kernel has for a new program's arguments and environment (ARG_MAX), which
+// counts every string, its \0, and a pointer to it. If they don't fit,
+// exec would fail with E2BIG; we find that out before starting anything, and
+// say exactly what is too big. Returns TRUE if they fit.
+static int argumentsFitInArgMax(char** commandArray)
+{
+    long argMax = sysconf(_SC_ARG_MAX);
+    size_t total = 0;
+    size_t length;
+    int i;
+
+    for (i = 0; commandArray[i] != NULL; i++)
+    {
+        length = strlen(commandArray[i]) + 1;
+        if (length > MAX_ARGUMENT_LENGTH)
+        {
+            fprintf(stderr, "smallsh: %s: argument %d is too long (%zu bytes; "
+                    "the limit is %d)\n", commandArray[0], i, length,
+                    MAX_ARGUMENT_LENGTH);
+            return FALSE;
+        }
+        total += length + sizeof(char*);
+    }
+    int argumentCount = i;
+    for (i = 0; environ[i] != NULL; i++)
+    {
+        total += strlen(environ[i]) + 1 + sizeof(char*);
+    }
+
+    if (argMax != -1 && total > (size_t) argMax)
+    {
+        fprintf(stderr, "smallsh: %s: argument list too long (%d arguments, "
+                "%zu bytes with the environment; the limit is %ld)\n",
+                commandArray[0], argumentCount, total, argMax);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// This function starts one pipeline stage, using one of the spawn functions
+// above (the zygote, if there is one), with the given files on its stdin,
+// stdout, and stderr (-1 means leave that one alone). processGroup,
+// placement (NULL for none), and execTime are passed along to them. Returns
+// the child's pid, or -1 (after reporting the problem).
+static pid_t spawnStage
+(
+    struct pipelineStage* stage,
+    int inputFD,
+    int outputFD,
+    int errorFD,
+    int actuallyRunInBackground,
+    pid_t processGroup,
+    struct placement* placement,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    long long* execTime
+)
+{
+    char** commandArray = stage->commandArray;
+    pid_t spawnPid = -1;
+
+    // Rather than letting execvp() try every directory in PATH, we find the
+    // executable ourselves (usually by remembering where it was last time):
+    char* executablePath = lookUpCommand(commandHashTable, commandArray[0]);
+
+    if (executablePath != NULL && argumentsFitInArgMax(commandArray) == FALSE)
+    {
+        return -1; // The problem has already been reported.
+    }
+
+    if (executablePath == NULL)
+    {
+        errno = ENOENT;
+    }
+    else if (zygote->socketFD != -1)
+    {
+        spawnPid = spawnWithZygote
+        (
+            zygote,
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            execTime
+        );
+    }
+    else if (USE_POSIX_SPAWN == TRUE)
+    {
+        spawnPid = spawnWithPosixSpawn
+        (
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            originalSigintAction,
+            execTime
+        );
+
+        if (spawnPid == -1 && errno == ENOENT &&
+            executablePath != commandArray[0])
+        {
+            // The file we remembered for this command has gone away, so we
+            // forget it and search PATH one more time:
+            forgetHashedCommand(commandHashTable, commandArray[0]);
+            executablePath = lookUpCommand(commandHashTable, commandArray[0]);
+
+            if (executablePath != NULL)
+            {
+                spawnPid = spawnWithPosixSpawn
+                (
+                    commandArray,
+                    executablePath,
+                    inputFD,
+                    outputFD,
+                    errorFD,
+                    actuallyRunInBackground,
+                    processGroup,
+                    placement,
+                    originalSigintAction,
+                    execTime
+                );
+            }
+            else
+            {
+                errno = ENOENT;
+            }
+        }
+    }
+    else
+    {
+        spawnPid = spawnWithFork
+        (
+            commandArray,
+            executablePath,
+            inputFD,
+            outputFD,
+            errorFD,
+            actuallyRunInBackground,
+            processGroup,
+            placement,
+            originalSigintAction,
+            execTime
+        );
+    }
+
+    if (spawnPid == -1)
+    {
+        perror("Error when attempting to execute command!");
+    }
+
+    return spawnPid;
+}
+
+// The next several functions are the commands that we run ourselves, without
+// starting a process (see struct builtIn). Each one takes a command array
+// that has already had its redirections cut off, writes to stdout and stderr
+// as usual, and returns the exit value that "status" should report.
+
+// This function outputs the backslash escape that starts at "text" (just
+// after the backslash), and returns a pointer to whatever comes after it:
+// \a \b \e \f \n \r \t \v \\, \xHH, and octal escapes, which are \0NNN for
+// "echo -e" and "printf %b" (octalNeedsZero is TRUE) and \NNN in printf
+// formats. \c means "stop all output", which we tell the caller with *stop.
+static char* outputEscape(char* text, int octalNeedsZero, int* stop)
+{
+    int value = 0;
+    int digits = 0;
+
+    *stop = FALSE;
+
+    if (*text == 'c')
+    {
+        *stop = TRUE;
+        return text + 1;
+    }
+    else if (*text == 'x' && isxdigit((unsigned char) text[1]))
+    {
+        text++;
+        while (digits < 2 && isxdigit((unsigned char) *text))
+        {
+            value = value * 16 +
+                    (isdigit((unsigned char) *text) ?
+                     *text - '0' : tolower((unsigned char) *text) - 'a' + 10);
+            text++;
+            digits++;
+        }
+        putchar(value);
+        return text;
+    }
+    else if (*text >= '0' && *text <= '7')
+    {
+        if (octalNeedsZero == TRUE && *text == '0')
+        {
+            text++;
+        }
+        while (digits < 3 && *text >= '0' && *text <= '7')
+        {
+            value = value * 8 + (*text - '0');
+            text++;
+            digits++;
+        }
+        if (octalNeedsZero == TRUE || digits > 0)
+        {
+            putchar(value);
+            return text;
+        }
+        // Otherwise (an "\8", say) fall through to output it as it is.
+    }
+
+    char* simpleEscapes = "a\ab\be\033f\fn\nr\rt\tv\v\\\\";
+    char* found = (*text != 0) ? strchr(simpleEscapes, *text) : NULL;
+
+    // Every other character in simpleEscapes is what the one before it
+    // stands for:
+    if (found != NULL && (found - simpleEscapes) % 2 == 0)
+    {
+        putchar(found[1]);
+        return text + 1;
+    }
+
+    // Not an escape that we know, so we output it as it is:
+    putchar('\\');
+    if (*text == 0)
+    {
+        return text;
+    }
+    putchar(*text);
+    return text + 1;
+}
+
+// This function outputs "text", expanding backslash escapes (see
+// outputEscape()). Returns FALSE if it hit a \c.
+static int outputWithEscapes(char* text, int octalNeedsZero)
+{
+    int stop = FALSE;
+
+    while (*text != 0)
+    {
+        if (*text == '\\')
+        {
+            text = outputEscape(text + 1, octalNeedsZero, &stop);
+            if (stop == TRUE)
+            {
+                return FALSE;
+            }
+        }
+        else
+        {
+            putchar(*text);
+            text++;
+        }
+    }
+
+    return TRUE;
+}
+
+// echo [-neE] [STRING...]
+// Like coreutils' echo: -n leaves off the newline, -e expands backslash
+// escapes, and -E (the default) doesn't.
+static int builtInEcho(char** commandArray, int arrayElementsUsed)
+{
+    int outputNewline = TRUE;
+    int expandEscapes = FALSE;
+    int i = 1;
+
+    // Options have to come first, and a word is only an option if every
+    // letter in it is one:
+    while (i < arrayElementsUsed && commandArray[i][0] == '-' &&
+           commandArray[i][1] != 0 &&
+           strspn(commandArray[i] + 1, "neE") == strlen(commandArray[i] + 1))
+    {
+        char* letter;
+        for (letter = commandArray[i] + 1; *letter != 0; letter++)
+        {
+            if (*letter == 'n')
+            {
+                outputNewline = FALSE;
+            }
+            else
+            {
+                expandEscapes = (*letter == 'e');
+            }
+        }
+        i++;
+    }
+
+    int firstWord = i;
+    for (; i < arrayElementsUsed; i++)
+    {
+        if (i > firstWord)
+        {
+            putchar(' ');
+        }
+
+        if (expandEscapes == FALSE)
+        {
+            fputs(commandArray[i], stdout);
+        }
+        else if (outputWithEscapes(commandArray[i], TRUE) == FALSE)
+        {
+            return 0; // \c means no more output, not even the newline.
+        }
+    }
+
+    if (outputNewline == TRUE)
+    {
+        putchar('\n');
+    }
+
+    return 0;
+}
+
+// true
+// (Every built-in takes the same arguments, for struct builtIn, but this one
+// and the next two don't look at them.)
+static int builtInTrue(char** commandArray, int arrayElementsUsed)
+{
+    (void) commandArray;
+    (void) arrayElementsUsed;
+
+    return 0;
+}
+
+// false
+static int builtInFalse(char** commandArray, int arrayElementsUsed)
+{
+    (void) commandArray;
+    (void) arrayElementsUsed;
+
+    return 1;
+}
+
+// pwd
+static int builtInPwd(char** commandArray, int arrayElementsUsed)
+{
+    (void) commandArray;
+    (void) arrayElementsUsed;
+
+    char* directory = getcwd(NULL, 0);
+
+    if (directory == NULL)
+    {
+        perror("pwd");
+        return 1;
+    }
+
+    printf("%s\n", directory);
+    free(directory);
+
+    return 0;
+}
+
+// This function converts a printf argument to a number. A leading ' or "
+// means the value of the character after it, as in C. If the argument isn't a
+// number, an error is output and *failed is set to TRUE.
+static long long printfArgumentToNumber(char* argument, int* failed)
+{
+    if (argument == NULL || argument[0] == 0)
+    {
+        return 0;
+    }
+
+    if (argument[0] == '\'' || argument[0] == '"')
+    {
+        return (unsigned char) argument[1];
+    }
+
+    char* end;
+    errno = 0;
+    long long value = strtoll(argument, &end, 0);
+
+    if (*end != 0 || errno != 0)
+    {
+        fprintf(stderr, "printf: %s: expected a numeric value\n", argument);
+        *failed = TRUE;
+    }
+
+    return value;
+}
+
+// printf FORMAT [ARGUMENT...]
+// Like coreutils' printf: the format is used as many times as it takes to use
+// up all of the arguments. %s %b %c %d %i %o %u %x %X %e %f %g %E %G and %%
+// are understood, with the usual flags, widths, and precisions (but not *).
+static int builtInPrintf(char** commandArray, int arrayElementsUsed)
+{
+    if (arrayElementsUsed < 2)
+    {
+        fprintf(stderr, "usage: printf FORMAT [ARGUMENT...]\n");
+        return 1;
+    }
+
+    char* format = commandArray[1];
+    int nextArgument = 2;
+    int failed = FALSE;
+    int stop = FALSE;
+    int argumentsBeforeThisPass;
+
+    do
+    {
+        argumentsBeforeThisPass = nextArgument;
+
+        char* text = format;
+        while (*text != 0)
+        {
+            if (*text == '\\')
+            {
+                text = outputEscape(text + 1, FALSE, &stop);
+                if (stop == TRUE)
+                {
+                    return (failed == TRUE) ? 1 : 0;
+                }
+                continue;
+            }
+
+            if (*text != '%')
+            {
+                putchar(*text);
+                text++;
+                continue;
+            }
+
+            if (text[1] == '%')
+            {
+                putchar('%');
+                text += 2;
+                continue;
+            }
+
+            // Copy the conversion (like "%-10.3s") so that we can hand it to
+            // the real printf(). There's room left over for an "ll".
+            char conversion[32];
+            size_t length = 0;
+            char* start = text;
+
+            conversion[length++] = *text++;
+            while (*text != 0 && strchr("-+ #0", *text) != NULL &&
+                   length < 8)
+            {
+                conversion[length++] = *text++;
+            }
+            while (isdigit((unsigned char) *text) && length < 16)
+            {
+                conversion[length++] = *text++;
+            }
+            if (*text == '.')
+            {
+                conversion[length++] = *text++;
+                while (isdigit((unsigned char) *text) && length < 24)
+                {
+                    conversion[length++] = *text++;
+                }
+            }
+
+            char type = *text;
+            if (type == 0 || strchr("sbcdiouxXeEfgG", type) == NULL)
+            {
+                fprintf(stderr, "printf: %.*s: invalid conversion\n",
+                        (int) (text - start + (type != 0)), start);
+                return 1;
+            }
+            text++;
+
+            char* argument = NULL;
+            if (nextArgument < arrayElementsUsed)
+            {
+                argument = commandArray[nextArgument];
+                nextArgument++;
+            }
+
+            if (type == 'b')
+            {
+                if (argument != NULL &&
+                    outputWithEscapes(argument, TRUE) == FALSE)
+                {
+                    return (failed == TRUE) ? 1 : 0;
+                }
+                continue;
+            }
+
+            if (type == 's' || type == 'c')
+            {
+                conversion[length++] = type;
+                conversion[length] = 0;
+                if (type == 's')
+                {
+                    printf(conversion, (argument != NULL) ? argument : "");
+                }
+                else if (argument != NULL && argument[0] != 0)
+                {
+                    printf(conversion, argument[0]);
+                }
+            }
+            else if (strchr("eEfgG", type) != NULL)
+            {
+                conversion[length++] = type;
+                conversion[length] = 0;
+
+                double value = 0;
+                if (argument != NULL && argument[0] != 0)
+                {
+                    char* end;
+                    value = strtod(argument, &end);
+                    if (*end != 0)
+                    {
+                        fprintf(stderr, "printf: %s: expected a numeric "
+                                "value\n", argument);
+                        failed = TRUE;
+                    }
+                }
+                printf(conversion, value);
+            }
+            else
+            {
+                conversion[length++] = 'l';
+                conversion[length++] = 'l';
+                conversion[length++] = type;
+                conversion[length] = 0;
+                printf(conversion, printfArgumentToNumber(argument, &failed));
+            }
+        }
+    }
+    while (nextArgument < arrayElementsUsed &&
+           nextArgument > argumentsBeforeThisPass);
+
+    return (failed == TRUE) ? 1 : 0;
+}
+
+// This function converts an argument of "test" to an integer, and returns
+// FALSE (after complaining) if it isn't one:
+static int testArgumentToInteger(char* argument, long long* value)
+{
+    char* end;
+    errno = 0;
+    *value = strtoll(argument, &end, 10);
+
+    if (argument[0] == 0 || *end != 0 || errno != 0)
+    {
+        fprintf(stderr, "test: %s: integer expression expected\n", argument);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// This function returns TRUE if "word" is one of the binary operators of
+// "test" (like "=" or "-lt"):
+static int isTestBinaryOperator(char* word)
+{
+    char* operators[] = {"=", "==", "!=", "-eq", "-ne", "-lt", "-le", "-gt",
+                         "-ge", "-nt", "-ot", "-ef", NULL};
+    int i;
+    for (i = 0; operators[i] != NULL; i++)
+    {
+        if (strcmp(word, operators[i]) == 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// This function evaluates one binary "test" expression:
+static int evaluateTestBinary
+(
+    char* left,
+    char* operator,
+    char* right,
+    int* error
+)
+{
+    if (strcmp(operator, "=") == 0 || strcmp(operator, "==") == 0)
+    {
+        return strcmp(left, right) == 0;
+    }
+    if (strcmp(operator, "!=") == 0)
+    {
+        return strcmp(left, right) != 0;
+    }
+
+    if (strcmp(operator, "-ef") == 0 || strcmp(operator, "-nt") == 0 ||
+        strcmp(operator, "-ot") == 0)
+    {
+        // These compare files:
+        struct stat leftInfo;
+        struct stat rightInfo;
+        int leftExists = (stat(left, &leftInfo) == 0);
+        int rightExists = (stat(right, &rightInfo) == 0);
+
+        if (strcmp(operator, "-ef") == 0)
+        {
+            return leftExists && rightExists &&
+                   leftInfo.st_dev == rightInfo.st_dev &&
+                   leftInfo.st_ino == rightInfo.st_ino;
+        }
+
+        if (strcmp(operator, "-ot") == 0)
+        {
+            // "A -ot B" is the same as "B -nt A".
+            char* swapName = left;
+            left = right;
+            right = swapName;
+            struct stat swapInfo = leftInfo;
+            leftInfo = rightInfo;
+            rightInfo = swapInfo;
+            int swapExists = leftExists;
+            leftExists = rightExists;
+            rightExists = swapExists;
+        }
+
+        if (leftExists == FALSE || rightExists == FALSE)
+        {
+            // A file that doesn't exist is older than one that does.
+            return leftExists;
+        }
+
+        return leftInfo.st_mtim.tv_sec > rightInfo.st_mtim.tv_sec ||
+               (leftInfo.st_mtim.tv_sec == rightInfo.st_mtim.tv_sec &&
+                leftInfo.st_mtim.tv_nsec > rightInfo.st_mtim.tv_nsec);
+    }
+
+    // Otherwise, it compares integers:
+    long long leftValue;
+    long long rightValue;
+
+    if (testArgumentToInteger(left, &leftValue) == FALSE ||
+        testArgumentToInteger(right, &rightValue) == FALSE)
+    {
+        *error = TRUE;
+        return FALSE;
+    }
+
+    if (strcmp(operator, "-eq") == 0)
+    {
+        return leftValue == rightValue;
+    }
+    else if (strcmp(operator, "-ne") == 0)
+    {
+        return leftValue != rightValue;
+    }
+    else if (strcmp(operator, "-lt") == 0)
+    {
+        return leftValue < rightValue;
+    }
+    else if (strcmp(operator, "-le") == 0)
+    {
+        return leftValue <= rightValue;
+    }
+    else if (strcmp(operator, "-gt") == 0)
+    {
+        return leftValue > rightValue;
+    }
+    else // -ge
+    {
+        return leftValue >= rightValue;
+    }
+}
+
+// This function evaluates one unary "test" expression (like "-f FILE"):
+static int evaluateTestUnary(char operator, char* operand)
+{
+    struct stat info;
+
+    if (operator == 'z')
+    {
+        return operand[0] == 0;
+    }
+    if (operator == 'n')
+    {
+        return operand[0] != 0;
+    }
+    if (operator == 't')
+    {
+        return isatty(atoi(operand));
+    }
+    if (operator == 'r' || operator == 'w' || operator == 'x')
+    {
+        int mode = (operator == 'r') ? R_OK : (operator == 'w') ? W_OK : X_OK;
+        return access(operand, mode) == 0;
+    }
+    if (operator == 'L' || operator == 'h')
+    {
+        return lstat(operand, &info) == 0 && S_ISLNK(info.st_mode);
+    }
+
+    if (stat(operand, &info) != 0)
+    {
+        return FALSE;
+    }
+
+    switch (operator)
+    {
+        case 'e':
+            return TRUE;
+        case 'f':
+            return S_ISREG(info.st_mode);
+        case 'd':
+            return S_ISDIR(info.st_mode);
+        case 'b':
+            return S_ISBLK(info.st_mode);
+        case 'c':
+            return S_ISCHR(info.st_mode);
+        case 'p':
+            return S_ISFIFO(info.st_mode);
+        case 'S':
+            return S_ISSOCK(info.st_mode);
+        case 's':
+            return info.st_size > 0;
+        case 'g':
+            return (info.st_mode & S_ISGID) != 0;
+        case 'u':
+            return (info.st_mode & S_ISUID) != 0;
+        default: // -k
+            return (info.st_mode & S_ISVTX) != 0;
+    }
+}
+
+// "test" expressions are parsed by recursive descent, from the lowest
+// precedence (-o) to the highest (a single test). Each of the next four
+// functions evaluates the expression that starts at words[*position], and
+// moves *position past it.
+
+static int evaluateTestOr(char** words, int count, int* position, int* error);
+
+static int evaluateTestPrimary
+(
+    char** words,
+    int count,
+    int* position,
+    int* error
+)
+{
+    int i = *position;
+
+    if (i >= count)
+    {
+        fprintf(stderr, "test: argument expected\n");
+        *error = TRUE;
+        return FALSE;
+    }
+
+    // A binary operator takes priority, so that "test -n = -n" compares two
+    // strings:
+    if (i + 2 < count && isTestBinaryOperator(words[i + 1]) == TRUE)
+    {
+        *position = i + 3;
+        return evaluateTestBinary(words[i], words[i + 1], words[i + 2],
+                                  error);
+    }
+
+    if (strcmp(words[i], "(") == 0 && i + 1 < count)
+    {
+        *position = i + 1;
+        int result = evaluateTestOr(words, count, position, error);
+        if (*position >= count || strcmp(words[*position], ")") != 0)
+        {
+            fprintf(stderr, "test: ')' expected\n");
+            *error = TRUE;
+            return FALSE;
+        }
+        (*position)++;
+        return result;
+    }
+
+    if (words[i][0] == '-' && words[i][1] != 0 && words[i][2] == 0 &&
+        strchr("bcdefghkLnprsStuwxz", words[i][1]) != NULL && i + 1 < count)
+    {
+        *position = i + 2;
+        return evaluateTestUnary(words[i][1], words[i + 1]);
+    }
+
+    // Just a string, which is true if it isn't empty:
+    *position = i + 1;
+    return words[i][0] != 0;
+}
+
+static int evaluateTestNot(char** words, int count, int* position, int* error)
+{
+    if (*position + 1 < count && strcmp(words[*position], "!") == 0)
+    {
+        (*position)++;
+        return !evaluateTestNot(words, count, position, error);
+    }
+
+    return evaluateTestPrimary(words, count, position, error);
+}
+
+static int evaluateTestAnd(char** words, int count, int* position, int* error)
+{
+    int result = evaluateTestNot(words, count, position, error);
+
+    while (*position < count && strcmp(words[*position], "-a") == 0)
+    {
+        (*position)++;
+        int next = evaluateTestNot(words, count, position, error);
+        result = result && next;
+    }
+
+    return result;
+}
+
+static int evaluateTestOr(char** words, int count, int* position, int* error)
+{
+    int result = evaluateTestAnd(words, count, position, error);
+
+    while (*position < count && strcmp(words[*position], "-o") == 0)
+    {
+        (*position)++;
+        int next = evaluateTestAnd(words, count, position, error);
+        result = result || next;
+    }
+
+    return result;
+}
+
+// test EXPRESSION
+// [ EXPRESSION ]
+// Returns 0 if the expression is true, 1 if it's false, and 2 if it's not an
+// expression. With no expression at all, it's false.
+static int builtInTest(char** commandArray, int arrayElementsUsed)
+{
+    int count = arrayElementsUsed;
+
+    if (strcmp(commandArray[0], "[") == 0)
+    {
+        if (strcmp(commandArray[count - 1], "]") != 0)
+        {
+            fprintf(stderr, "[: missing ]\n");
+            return 2;
+        }
+        count--;
+    }
+
+    if (count == 1)
+    {
+        return 1;
+    }
+
+    int position = 1;
+    int error = FALSE;
+    int result = evaluateTestOr(commandArray, count, &position, &error);
+
+    if (error == FALSE && position < count)
+    {
+        fprintf(stderr, "test: %s: unexpected argument\n",
+                commandArray[position]);
+        error = TRUE;
+    }
+
+    if (error == TRUE)
+    {
+        return 2;
+    }
+
+    return (result == TRUE) ? 0 : 1;
+}
+
+// This is the table of commands that we run ourselves:
+static struct builtIn builtIns[] =
+{
+    {"echo", builtInEcho},
+    {"true", builtInTrue},
+    {"false", builtInFalse},
+    {"pwd", builtInPwd},
+    {"printf", builtInPrintf},
+    {"test", builtInTest},
+    {"[", builtInTest},
+    {NULL, NULL}
+};
+
+// This function returns the entry in builtIns for the command "name", or NULL
+// if we have to start a process for it:
+static struct builtIn* findBuiltIn(char* name)
+{
+    if (USE_BUILT_INS == FALSE)
+    {
+        return NULL;
+    }
+
+    int i;
+    for (i = 0; builtIns[i].name != NULL; i++)
+    {
+        if (strcmp(name, builtIns[i].name) == 0)
+        {
+            return &builtIns[i];
+        }
+    }
+
+    return NULL;
+}
+
+// This function points file descriptor "target" (0 or 1) at "fd" for as long
+// as a built-in command runs. Returns a copy of the original, for
+// restoreFileDescriptor(), or -1 if there was nothing to do (or it failed).
+static int redirectFileDescriptor(int fd, int target)
+{
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    int savedFD = fcntl(target, F_DUPFD_CLOEXEC, 10);
+
+    if (savedFD == -1 || dup2(fd, target) == -1)
+    {
+        perror("Error when initiating redirection!");
+        if (savedFD != -1)
+        {
+            close(savedFD);
+        }
+        return -1;
+    }
+
+    return savedFD;
+}
+
+// This function undoes redirectFileDescriptor():
+static void restoreFileDescriptor(int savedFD, int target)
+{
+    if (savedFD != -1)
+    {
+        dup2(savedFD, target);
+        close(savedFD);
+    }
+
+    return;
+}
+
+// This function runs a command from builtIns in the shell itself. It honors
+// "<" and ">" by pointing our own stdin and stdout at the files while it runs,
+// and putting them back afterwards. stdout is flushed on each side of that so
+// that output ends up in the right place. A timed built-in is measured with
+// getrusage(RUSAGE_SELF), since there is no child process.
+static void runBuiltIn
+(
+    struct builtIn* builtIn,
+    char** commandArray,
+    int arrayElementsUsed,
+    int* statusType,
+    int* statusValue,
+    int timeThisCommand,
+    struct resourceReport* resourceReport
+)
+{
+    struct pipelineStage stage;
+    stage.commandArray = commandArray;
+    stage.arrayElementsUsed = arrayElementsUsed;
+    findRedirections(&stage);
+
+    int inputFD = -1;
+    int outputFD = -1;
+
+    *statusType = EXIT_VALUE;
+    *statusValue = 1;
+
+    if
+    (
+        openRedirectionFiles
+        (
+            stage.fileForInputRedirection,
+            stage.fileForOutputRedirection,
+            &inputFD,
+            &outputFD
+        ) == FALSE
+    )
+    {
+        return;
+    }
+
+    if (stage.textForInput != NULL)
+    {
+        inputFD = openInputText(stage.textForInput, stage.textNeedsNewline);
+        if (inputFD == -1)
+        {
+            if (outputFD != -1)
+            {
+                close(outputFD);
+            }
+            return;
+        }
+    }
+
+    struct timespec startTime;
+    struct rusage usageBefore;
+    if (timeThisCommand == TRUE)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &startTime);
+        getrusage(RUSAGE_SELF, &usageBefore);
+    }
+
+    fflush(stdout);
+    int savedInputFD = redirectFileDescriptor(inputFD, STDIN_FILENO);
+    int savedOutputFD = redirectFileDescriptor(outputFD, STDOUT_FILENO);
+
+    *statusValue = builtIn->run(stage.commandArray, stage.arrayElementsUsed);
+
+    if (fflush(stdout) == EOF || ferror(stdout))
+    {
+        perror(builtIn->name);
+        clearerr(stdout);
+        *statusValue = 1;
+    }
+
+    restoreFileDescriptor(savedInputFD, STDIN_FILENO);
+    restoreFileDescriptor(savedOutputFD, STDOUT_FILENO);
+
+    int usedFDs[2] = {inputFD, outputFD};
+    closeIfOpen(usedFDs, 2);
+
+    if (timeThisCommand == TRUE)
+    {
+        struct rusage usageAfter;
+        getrusage(RUSAGE_SELF, &usageAfter);
+
+        timersub
+        (
+            &usageAfter.ru_utime,
+            &usageBefore.ru_utime,
+            &resourceReport->userTime
+        );
+        timersub
+        (
+            &usageAfter.ru_stime,
+            &usageBefore.ru_stime,
+            &resourceReport->systemTime
+        );
+        resourceReport->maxResidentKilobytes = usageAfter.ru_maxrss;
+        resourceReport->voluntaryContextSwitches =
+            usageAfter.ru_nvcsw - usageBefore.ru_nvcsw;
+        resourceReport->involuntaryContextSwitches =
+            usageAfter.ru_nivcsw - usageBefore.ru_nivcsw;
+
+        finishResourceReport(resourceReport, &startTime);
+    }
+
+    return;
+}
+
+// This function counts the stages in a pipeline ("cmd1 | cmd2 | ..."), which
+// is one more than the number of PIPE_SYMBOLs in the command array:
+static int countPipelineStages(char** commandArray, int arrayElementsUsed)
+{
+    int stageCount = 1;
+    int i;
+    for (i = 0; i < arrayElementsUsed; i++)
+    {
+        if (strcmp(commandArray[i], PIPE_SYMBOL) == 0)
+        {
+            stageCount++;
+        }
+    }
+
+    return stageCount;
+}
+
+// This function starts every stage of a pipeline (a plain command is just a
+// pipeline with one stage) without waiting for any of them. stagePids must
+// have room for countPipelineStages() pids; each one is set to the stage's
+// pid, or -1 if that stage couldn't be started. defaultInputFile and
+// defaultOutputFile (which may be NULL) are used for the first stage's input
+// and the last stage's output unless the user redirected those. If captureFD
+// isn't -1, it takes the place of defaultOutputFile, and every stage's stderr
+// goes to it, too (see struct jobLog). processGroup and placement (NULL for
+// none) are passed along to the spawn functions, and afterwards processGroup
+// holds the group that the pipeline actually ended up in. The times that
+// processes were started go into "trace" (which may be NULL). Returns FALSE
+// (after reporting the problem) if nothing was started because the command
+// line was bad or a redirection file couldn't be opened.
+static int launchPipeline
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    pid_t* stagePids,
+    char* defaultInputFile,
+    char* defaultOutputFile,
+    int captureFD,
+    int actuallyRunInBackground,
+    pid_t* processGroup,
+    struct placement* placement,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    struct commandTrace* trace
+)
+{
+    // Split the command array into pipeline stages wherever there is a
+    // PIPE_SYMBOL. Each stage's command array is just a piece of the whole
+    // one; replacing each PIPE_SYMBOL with a NULL ends the piece before it.
+
+    int stageCount = countPipelineStages(commandArray, arrayElementsUsed);
+    int i;
+
+    struct pipelineStage stages[stageCount];
+    int stage = 0;
+
+    stages[0].commandArray = commandArray;
+    stages[0].arrayElementsUsed = 0;
+    for (i = 0; i < arrayElementsUsed; i++)
+    {
+        if (strcmp(commandArray[i], PIPE_SYMBOL) == 0)
+        {
+            commandArray[i] = NULL;
+            stage++;
+            stages[stage].commandArray = &commandArray[i + 1];
+            stages[stage].arrayElementsUsed = 0;
+        }
+        else
+        {
+            stages[stage].arrayElementsUsed++;
+        }
+    }
+
+    for (stage = 0; stage < stageCount; stage++)
+    {
+        if (stages[stage].arrayElementsUsed == 0)
+        {
+            outputStringWithANewline("smallsh: missing command next to |");
+            return FALSE;
+        }
+
+        findRedirections(&stages[stage]);
+    }
+
+    // Background commands (for example) read from and write to /dev/null
+    // unless the user has already specified some other redirection:
+    if (stages[0].fileForInputRedirection == NULL &&
+        stages[0].textForInput == NULL)
+    {
+        stages[0].fileForInputRedirection = defaultInputFile;
+    }
+    if (stages[stageCount - 1].fileForOutputRedirection == NULL &&
+        captureFD == -1)
+    {
+        stages[stageCount - 1].fileForOutputRedirection = defaultOutputFile;
+    }
+
+    // Open every stage's redirection files before starting anything, so that
+    // a bad file name doesn't leave half of a pipeline running:
+
+    int inputFDs[stageCount];
+    int outputFDs[stageCount];
+
+    for (stage = 0; stage < stageCount; stage++)
+    {
+        inputFDs[stage] = -1;
+        outputFDs[stage] = -1;
+    }
+
+    for (stage = 0; stage < stageCount; stage++)
+    {
+        if
+        (
+            openRedirectionFiles
+            (
+                stages[stage].fileForInputRedirection,
+                stages[stage].fileForOutputRedirection,
+                &inputFDs[stage],
+                &outputFDs[stage]
+            ) == FALSE
+        )
+        {
+            closeIfOpen(inputFDs, stageCount);
+            closeIfOpen(outputFDs, stageCount);
+            return FALSE;
+        }
+
+        if (stages[stage].textForInput != NULL)
+        {
+            inputFDs[stage] = openInputText
+            (
+                stages[stage].textForInput,
+                stages[stage].textNeedsNewline
+            );
+            if (inputFDs[stage] == -1)
+            {
+                closeIfOpen(inputFDs, stageCount);
+                closeIfOpen(outputFDs, stageCount);
+                return FALSE;
+            }
+        }
+    }
+
+    // NOW WE SPAWN THE CHILDREN !!!
+
+    // Every stage is started before we wait for any of them, so they all run
+    // at the same time, each one reading what the one before it writes. The
+    // pipes are created with O_CLOEXEC: the only copies that survive into a
+    // command are the ones moved onto its stdin or stdout.
+
+    int pipeReadEnd = -1; // The read end of the pipe from the previous stage.
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->forkTime = monotonicNanoseconds();
+        trace->stageCount = stageCount;
+    }
+
+    for (stage = 0; stage < stageCount; stage++)
+    {
+        int pipeEnds[2] = {-1, -1};
+
+        if (stage < stageCount - 1)
+        {
+            if (pipe2(pipeEnds, O_CLOEXEC) == -1)
+            {
+                perror("Error when creating a pipe!");
+                pipeEnds[0] = -1;
+                pipeEnds[1] = -1;
+            }
+            else if (PIPE_BUFFER_SIZE > 0)
+            {
+                // This is only a hint; if the system won't allow it, the
+                // default size still works.
+                fcntl(pipeEnds[1], F_SETPIPE_SZ, PIPE_BUFFER_SIZE);
+            }
+        }
+
+        // A stage's own redirection takes priority over the pipe:
+        int inputFD =
+            (inputFDs[stage] != -1) ? inputFDs[stage] : pipeReadEnd;
+        int outputFD =
+            (outputFDs[stage] != -1) ? outputFDs[stage] : pipeEnds[1];
+        if (outputFD == -1)
+        {
+            outputFD = captureFD; // Only the last stage can get here.
+        }
+
+        stagePids[stage] = spawnStage
+        (
+            &stages[stage],
+            inputFD,
+            outputFD,
+            captureFD,
+            actuallyRunInBackground,
+            *processGroup,
+            placement,
+            originalSigintAction,
+            commandHashTable,
+            zygote,
+            (tracing(trace) == TRUE && stage == stageCount - 1) ?
+                &trace->execTime : NULL
+        );
+
+        if (stagePids[stage] != -1 && *processGroup == 0)
+        {
+            *processGroup = stagePids[stage];
+        }
+
+        // The child has its own copies of these now. Closing ours matters:
+        // a stage only sees end-of-file once every copy of the write end of
+        // its input pipe is closed.
+        int usedFDs[4] = {inputFDs[stage], outputFDs[stage], pipeReadEnd,
+                          pipeEnds[1]};
+        closeIfOpen(usedFDs, 4);
+
+        pipeReadEnd = pipeEnds[0];
+    }
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->processID = stagePids[stageCount - 1];
+    }
+
+    return TRUE;
+}
+
+// A foreground command with a "timeout" gets a process group of its own (see
+// executeCommand()). That makes it a background process group as far as the
+// terminal is concerned: Ctrl-C wouldn't reach it, and reading from the
+// terminal would stop it with SIGTTIN. So if the shell has the terminal (as
+// its stdin), this function hands the terminal to the command's process
+// group. Returns TRUE if it did, in which case takeBackTerminal() has to be
+// called once the command is done.
+static int handTerminalTo(pid_t processGroup)
+{
+    if (isatty(STDIN_FILENO) == 0 || tcgetpgrp(STDIN_FILENO) != getpgrp() ||
+        tcsetpgrp(STDIN_FILENO, processGroup) == -1)
+    {
+        return FALSE;
+    }
+
+    // A stage that tried to read from the terminal before it was handed over
+    // has been stopped:
+    kill(-processGroup, SIGCONT);
+
+    return TRUE;
+}
+
+// This function gives the terminal back to the shell's own process group
+// (see handTerminalTo()):
+static void takeBackTerminal()
+{
+    // Right now the shell is in a background process group itself, so
+    // tcsetpgrp() would stop it with SIGTTOU unless that is blocked:
+    sigset_t ttouSignal;
+    sigset_t previousMask;
+    sigemptyset(&ttouSignal);
+    sigaddset(&ttouSignal, SIGTTOU);
+    sigprocmask(SIG_BLOCK, &ttouSignal, &previousMask);
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+    sigprocmask(SIG_SETMASK, &previousMask, NULL);
+
+    return;
+}
+
+// This function evalutes the command array to see if there is a need for
+// a pipeline, input/output redirection, or running in the background. It then
+// actually executes the command with launchPipeline(). It also deals with the
+// aftermath of executing a command by waiting for foreground commands (and
+// noting their manner of termination) and by adding background commands
+// to the job table. If timeThisCommand is TRUE, a foreground command's
+// resource usage is measured, reported on stderr, and kept in
+// *resourceReport for "status" and "time". If timeLimit is more than 0, the
+// command is stopped if it's still running after that many seconds (see
+// "timeout"). Its processes get placements->foreground or
+// placements->background (see struct placement). A background command is
+// queued instead of started if the admission policy says so (see
+// admitBackgroundJob()). In trace mode, the command's trace is filled in and
+// written out (see writeTrace()); "trace" may be NULL.
+static void executeCommand
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    int* statusType,
+    int* statusValue,
+    int* usingBackgroundIsPossible,
+    struct jobTable* jobTable,
+    struct eventLoop* eventLoop,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    int timeThisCommand,
+    double timeLimit,
+    struct placementSettings* placements,
+    struct resourceReport* resourceReport,
+    struct commandTrace* trace
+)
+{
+    int actuallyRunInBackground = FALSE;
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->commandLine = joinWords(commandArray, arrayElementsUsed);
+    }
+
+    // See if there is a BACKGROUND_SYMBOL as the last element in the command
+    // array, and if so deal with it:
+
+    char* commandLine = NULL; // What "jobs" will show for this command.
+
+    if (strcmp(commandArray[arrayElementsUsed - 1], BACKGROUND_SYMBOL) == 0)
+    {
+        if (*usingBackgroundIsPossible == TRUE)
+        {
+            actuallyRunInBackground = TRUE;
+            commandLine = joinWords(commandArray, arrayElementsUsed);
+        }
+        arrayElementsUsed--;
+    }
+
+    if (actuallyRunInBackground == FALSE)
+    {
+        // Until we have measured this command, there's nothing to report:
+        resourceReport->available = FALSE;
+    }
+
+    if (arrayElementsUsed == 0)
+    {
+        // Nothing is left to run (the user typed only "&").
+        free(commandLine);
+        writeTrace(trace);
+        return;
+    }
+
+    // A background command may have to wait its turn. Once anything is
+    // queued, everything after it waits, too, so that they start in order.
+    // (The command at the front of the queue is the one that
+    // startQueuedJobs() is starting now.)
+    if (actuallyRunInBackground == TRUE &&
+        ((jobTable->queueHead != NULL &&
+          jobTable->queueHead->commandArray != commandArray) ||
+         (jobTable->queueHead == NULL &&
+          admitBackgroundJob(jobTable) == FALSE)))
+    {
+        queueBackgroundJob
+        (
+            jobTable,
+            commandArray,
+            arrayElementsUsed + 1, // With the "&".
+            timeLimit,
+            &placements->background
+        );
+
+        if (tracing(trace) == TRUE)
+        {
+            trace->background = TRUE;
+        }
+        writeTrace(trace);
+        free(commandLine);
+        return;
+    }
+
+    // A simple foreground command that we can run ourselves doesn't need a
+    // process at all:
+    struct builtIn* builtIn = findBuiltIn(commandArray[0]);
+    if (builtIn != NULL && actuallyRunInBackground == FALSE &&
+        countPipelineStages(commandArray, arrayElementsUsed) == 1)
+    {
+        runBuiltIn
+        (
+            builtIn,
+            commandArray,
+            arrayElementsUsed,
+            statusType,
+            statusValue,
+            timeThisCommand,
+            resourceReport
+        );
+
+        if (tracing(trace) == TRUE)
+        {
+            trace->builtIn = TRUE;
+            trace->stageCount = 1;
+            trace->exitTime = monotonicNanoseconds();
+            trace->exitValue = *statusValue;
+        }
+        writeTrace(trace);
+        return;
+    }
+
+    struct timespec startTime;
+    if (timeThisCommand == TRUE)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &startTime);
+    }
+
+    // If the command is going to run in the background, then we will need to
+    // set up input and output redirection (unless the user has already
+    // specified such redirection). Background pipelines also get a process
+    // group of their own (named after the first stage's pid), so that the
+    // whole pipeline can be signalled at once.
+
+    int stageCount = countPipelineStages(commandArray, arrayElementsUsed);
+    pid_t stagePids[stageCount];
+    pid_t processGroup = (actuallyRunInBackground == TRUE) ? 0 : -1;
+
+    long long deadline = 0; // For "timeout".
+    if (timeLimit > 0)
+    {
+        deadline = monotonicNanoseconds() +
+                   (long long)(timeLimit * 1000000000.0);
+
+        // Like a background job, the command gets a process group of its
+        // own, so that when the time runs out, whatever processes it has
+        // started can be signalled along with it:
+        processGroup = 0;
+    }
+    char* defaultFile = (actuallyRunInBackground == TRUE) ? DEV_NULL : NULL;
+
+    struct placement* placement = (actuallyRunInBackground == TRUE) ?
+        &placements->background : &placements->foreground;
+    if (placementIsEmpty(placement) == TRUE)
+    {
+        placement = NULL;
+    }
+
+    // When background output is captured, it goes into a pipe instead of to
+    // /dev/null (see struct jobLog):
+    struct jobLog* log = NULL;
+    int captureFD = -1;
+    if (actuallyRunInBackground == TRUE)
+    {
+        log = openJobLog(jobTable, &captureFD);
+    }
+
+    int launched = launchPipeline
+    (
+        commandArray,
+        arrayElementsUsed,
+        stagePids,
+        defaultFile,
+        defaultFile,
+        captureFD,
+        actuallyRunInBackground,
+        &processGroup,
+        placement,
+        originalSigintAction,
+        commandHashTable,
+        zygote,
+        trace
+    );
+
+    // The children have their own copies of the write end now. Once they
+    // have all closed theirs, the log's pipe reaches end-of-file.
+    if (captureFD != -1)
+    {
+        close(captureFD);
+    }
+
+    if (launched == FALSE || stagePids[stageCount - 1] == -1)
+    {
+        if (log != NULL)
+        {
+            freeJobLog(jobTable, log);
+            log = NULL;
+        }
+    }
+
+    if (launched == FALSE)
+    {
+        // The command never ran, but as far as "status" is concerned, it
+        // failed:
+        if (actuallyRunInBackground == FALSE)
+        {
+            *statusType = EXIT_VALUE;
+            *statusValue = 1;
+        }
+        free(commandLine);
+        writeTrace(trace);
+        return;
+    }
+
+    int stage;
+
+    pid_t lastPid = stagePids[stageCount - 1];
+
+    if (actuallyRunInBackground == FALSE)
+    {
+        // We're running the command in the foreground, so we have to wait
+        // for every stage of it to terminate:
+
+        int childExitMethod = -5;
+        int lastExitMethod = -5;
+        struct rusage usage;
+
+        timerclear(&resourceReport->userTime);
+        timerclear(&resourceReport->systemTime);
+        resourceReport->maxResidentKilobytes = 0;
+        resourceReport->voluntaryContextSwitches = 0;
+        resourceReport->involuntaryContextSwitches = 0;
+
+        int stagesRunning = 0;
+        for (stage = 0; stage < stageCount; stage++)
+        {
+            if (stagePids[stage] != -1)
+            {
+                stagesRunning++; // Some stages may never have started.
+            }
+        }
+
+        int timedOut = FALSE;
+        int handedOverTerminal = FALSE;
+        if (processGroup > 0)
+        {
+            handedOverTerminal = handTerminalTo(processGroup);
+        }
+
+        // Children finish in whatever order they finish in. Any background
+        // process that finishes while we wait is reported right away.
+        while (stagesRunning > 0)
+        {
+            pid_t resultPid = waitForChild
+            (
+                eventLoop,
+                jobTable,
+                deadline,
+                &childExitMethod,
+                &usage
+            );
+
+            if (resultPid == 0)
+            {
+                // The time has run out. As for a background job (see
+                // enforceDeadlines()), the command's process group gets
+                // SIGTERM, and then SIGKILL if a stage is still running after
+                // the grace period.
+                if (timedOut == FALSE)
+                {
+                    kill(-processGroup, SIGTERM);
+                    kill(-processGroup, SIGCONT);
+                    timedOut = TRUE;
+                    deadline = monotonicNanoseconds() +
+                               (long long)(gracePeriod() * 1000000000.0);
+                }
+                else
+                {
+                    kill(-processGroup, SIGKILL);
+                    deadline = 0;
+                }
+                continue;
+            }
+
+            if (tracing(trace) == TRUE && trace->waitTime == 0)
+            {
+                trace->waitTime = monotonicNanoseconds();
+            }
+
+            if (resultPid == -1)
+            {
+                perror("Error when waiting for a foreground process!");
+                break;
+            }
+
+            for (stage = 0; stage < stageCount; stage++)
+            {
+                if (stagePids[stage] == resultPid)
+                {
+                    break;
+                }
+            }
+
+            if (stage == stageCount)
+            {
+                reportFinishedBackgroundProcess
+                (
+                    resultPid,
+                    childExitMethod,
+                    jobTable,
+                    FALSE
+                );
+                continue;
+            }
+
+            stagesRunning--;
+            stagePids[stage] = -1; // Its pid may be used again.
+            if (resultPid == lastPid)
+            {
+                lastExitMethod = childExitMethod;
+            }
+
+            timeradd
+            (
+                &resourceReport->userTime,
+                &usage.ru_utime,
+                &resourceReport->userTime
+            );
+            timeradd
+            (
+                &resourceReport->systemTime,
+                &usage.ru_stime,
+                &resourceReport->systemTime
+            );
+            if (usage.ru_maxrss > resourceReport->maxResidentKilobytes)
+            {
+                resourceReport->maxResidentKilobytes = usage.ru_maxrss;
+            }
+            resourceReport->voluntaryContextSwitches += usage.ru_nvcsw;
+            resourceReport->involuntaryContextSwitches += usage.ru_nivcsw;
+        }
+
+        if (handedOverTerminal == TRUE)
+        {
+            takeBackTerminal();
+        }
+
+        if (timeThisCommand == TRUE)
+        {
+            finishResourceReport(resourceReport, &startTime);
+        }
+
+        if (tracing(trace) == TRUE)
+        {
+            trace->exitTime = monotonicNanoseconds();
+            if (lastPid != -1 && WIFEXITED(lastExitMethod) != 0)
+            {
+                trace->exitValue = WEXITSTATUS(lastExitMethod);
+            }
+            else if (lastPid != -1 && WIFSIGNALED(lastExitMethod) != 0)
+            {
+                trace->signal = WTERMSIG(lastExitMethod);
+            }
+        }
+
+        // (If a SIGTSTP came in while we were waiting, it is dealt with now,
+        // before the next line is read, by handleSignals().)
+
+        // Now we need to update our state variables to reflect the way that
+        // the foreground process terminated. For a pipeline, that's the way
+        // its last stage terminated:
+
+        if (lastPid == -1)
+        {
+            // The last stage couldn't be started, which "status" treats the
+            // same as the command failing:
+            *statusType = EXIT_VALUE;
+            *statusValue = 1;
+        }
+        else if (timedOut == TRUE)
+        {
+            // However the command ended after that, it didn't finish in
+            // time:
+            *statusType = EXIT_VALUE;
+            *statusValue = TIMED_OUT_STATUS;
+        }
+        else if (WIFEXITED(lastExitMethod) != 0)
+        {
+            // The process exited by exit(0), exit(1), return 0, etc.
+            *statusType = EXIT_VALUE;
+            *statusValue = WEXITSTATUS(lastExitMethod);
+        }
+        else if (WIFSIGNALED(lastExitMethod) != 0)
+        {
+            // The process exited because of an uncaught signal.
+            *statusType = SIGNAL_RECEIVED;
+            *statusValue = WTERMSIG(lastExitMethod);
+            printf("terminated by signal %d\n", *statusValue);
+        } else {
+            perror("A process ended for reasons unknown!");
+            exit(1);
+        }
+    } else if (lastPid != -1) {
+        // We're running the file in the background, so we aren't going to wait
+        // for it, but we do have to announce that it's in the background:
+
+        char backgroundMessage[STATUS_REPORT_MAX_LENGTH];
+        sprintf(backgroundMessage, "background pid is %d", lastPid);
+        outputStringWithANewline(backgroundMessage);
+
+        // We also have to add it to the job table. A pipeline is known by
+        // the pid of its last stage; the other stages are reaped (quietly)
+        // when they finish.
+
+        struct job* newJob = rememberJob(jobTable, lastPid, commandLine);
+        newJob->processGroup = processGroup;
+
+        if (deadline != 0)
+        {
+            setJobDeadline(jobTable, newJob, deadline);
+        }
+
+        if (log != NULL)
+        {
+            log->processID = lastPid;
+            log->commandLine = strdup(commandLine);
+            newJob->log = log;
+            watchJobLog(jobTable, log);
+        }
+    }
+
+    if (tracing(trace) == TRUE)
+    {
+        trace->background = actuallyRunInBackground;
+    }
+    writeTrace(trace);
+
+    free(commandLine);
+
+    return;
+}
+
+// This function starts queued background commands (see queueBackgroundJob()),
+// in the order they were queued, for as long as admitBackgroundJob() lets
+// it. Each one runs just as it would have when it was typed, except that it
+// starts in whatever the shell's current directory is now. This is only
+// called between commands (after handleSignals() has made room by reaping
+// finished jobs, from "wait", and from "admit"), never while the shell is in
+// the middle of reaping or starting something. Returns how many it started.
+static int startQueuedJobs(struct jobTable* jobTable)
+{
+    int started = 0;
+
+    while (jobTable->queueHead != NULL &&
+           admitBackgroundJob(jobTable) == TRUE)
+    {
+        struct queuedJob* job = jobTable->queueHead;
+
+        // A background command doesn't use (or change) any of these:
+        int statusType = EXIT_VALUE;
+        int statusValue = 0;
+        int usingBackgroundIsPossible = TRUE;
+        struct resourceReport resourceReport;
+        memset(&resourceReport, 0, sizeof(resourceReport));
+        struct placementSettings placements;
+        memset(&placements, 0, sizeof(placements));
+        placements.background = job->placement;
+
+        // The command stays at the front of the queue while it is started,
+        // which is how executeCommand() knows not to queue it again:
+        executeCommand
+        (
+            job->commandArray,
+            job->arrayElementsUsed,
+            &statusType,
+            &statusValue,
+            &usingBackgroundIsPossible,
+            jobTable,
+            jobTable->eventLoop,
+            jobTable->originalSigintAction,
+            jobTable->commandHashTable,
+            jobTable->zygote,
+            FALSE,
+            job->timeLimit,
+            &placements,
+            &resourceReport,
+            NULL
+        );
+
+        freeQueuedJob(dequeueBackgroundJob(jobTable));
+        started++;
+    }
+
+    return started;
+}
+
+// This function reports how a command that "parallel" ran ended, if it
+// failed, and returns TRUE if it succeeded:
+static int reportParallelResult(char* commandLine, int childExitMethod)
+{
+    char statusReport[STATUS_REPORT_MAX_LENGTH];
+
+    if (WIFEXITED(childExitMethod) != 0)
+    {
+        if (WEXITSTATUS(childExitMethod) == 0)
+        {
+            return TRUE;
+        }
+        sprintf
+        (
+            statusReport,
+            "exit value %d",
+            WEXITSTATUS(childExitMethod)
+        );
+    }
+    else
+    {
+        sprintf
+        (
+            statusReport,
+            "terminated by signal %d",
+            WTERMSIG(childExitMethod)
+        );
+    }
+
+    printf("parallel: %s: %s\n", commandLine, statusReport);
+    fflush(stdout);
+
+    return FALSE;
+}
+
+// This function implements the "parallel" built-in command:
+//     parallel [-j N] [FILE]
+// Every line of FILE (or, without FILE, of stdin--which, if that's where the
+// shell's own commands are coming from, means the lines that follow this
+// one) is a command, and up to N of them (by default, one per CPU) are kept
+// running at a time. Whenever one finishes, the next line is started in its
+// place. At the end, we output how many succeeded and how many failed, and
+// "status" is the number that failed.
+// The commands are like foreground commands (Ctrl-C stops them) except that
+// they read from /dev/null unless redirected, since the shell may itself be
+// reading stdin, and they get the foreground placement (see struct
+// placement). waitForChild() also picks up background processes that finish
+// in the meantime; those are reported as usual.
+static void runParallel
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct inputReader* shellReader,
+    char* processIdString,
+    int* statusType,
+    int* statusValue,
+    struct jobTable* jobTable,
+    struct eventLoop* eventLoop,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    struct placementSettings* placements
+)
+{
+    long slotCount = sysconf(_SC_NPROCESSORS_ONLN);
+    char* fileName = NULL;
+    int badUsage = FALSE;
+    struct placement* placement = &placements->foreground;
+    if (placementIsEmpty(placement) == TRUE)
+    {
+        placement = NULL;
+    }
+
+    int i;
+    for (i = 1; i < arrayElementsUsed; i++)
+    {
+        if (strcmp(commandArray[i], "-j") == 0 && i + 1 < arrayElementsUsed)
+        {
+            char* end;
+            i++;
+            slotCount = strtol(commandArray[i], &end, 10);
+            if (*end != 0 || end == commandArray[i] || slotCount < 1 ||
+                slotCount > MAX_PARALLEL_JOBS)
+            {
+                badUsage = TRUE;
+            }
+        }
+        else if (fileName == NULL && commandArray[i][0] != '-')
+        {
+            fileName = commandArray[i];
+        }
+        else
+        {
+            badUsage = TRUE;
+        }
+    }
+
+    *statusType = EXIT_VALUE;
+    *statusValue = 1;
+
+    if (badUsage == TRUE)
+    {
+        fprintf(stderr, "usage: parallel [-j N] [FILE] (N from 1 to %d)\n",
+                MAX_PARALLEL_JOBS);
+        return;
+    }
+    if (slotCount < 1)
+    {
+        slotCount = 1;
+    }
+    else if (slotCount > MAX_PARALLEL_JOBS)
+    {
+        slotCount = MAX_PARALLEL_JOBS; // (Only possible with that many CPUs.)
+    }
+
+    struct parallelSlot* slots =
+        malloc(slotCount * sizeof(struct parallelSlot));
+    if (slots == NULL)
+    {
+        // Running out of memory here is no reason to end the shell:
+        perror("Error when allocating memory for parallel!");
+        return;
+    }
+    for (i = 0; i < slotCount; i++)
+    {
+        slots[i].processID = -1;
+        slots[i].commandLine = NULL;
+    }
+
+    // Figure out where the commands come from:
+
+    struct inputReader fileReader;
+    struct inputReader* reader = &fileReader;
+
+    if (fileName != NULL)
+    {
+        int fileFD = open(fileName, O_RDONLY | O_CLOEXEC);
+        if (fileFD == -1)
+        {
+            perror(fileName);
+            free(slots);
+            return;
+        }
+        openInputReader(&fileReader, fileFD, FALSE);
+    }
+    else if (shellReader->fd == STDIN_FILENO)
+    {
+        // The shell may already have read some of these lines into its
+        // buffer, so we have to get them from there:
+        reader = shellReader;
+    }
+    else
+    {
+        openInputReader(&fileReader, STDIN_FILENO, FALSE);
+    }
+
+    struct wordList lineWords = {NULL, 0};
+    char** lineArray;
+    struct wordArena arena = {NULL, NULL};
+    int running = 0;
+    int started = 0;
+    int failed = 0;
+    int outOfCommands = FALSE;
+
+    while (outOfCommands == FALSE || running > 0)
+    {
+        // Fill every free slot:
+
+        while (outOfCommands == FALSE && running < slotCount)
+        {
+            char* line;
+            int result = readInputLine(reader, &line);
+
+            if (result == -1)
+            {
+                continue; // Interrupted by a signal.
+            }
+            if (result == FALSE)
+            {
+                outOfCommands = TRUE;
+                break;
+            }
+
+            resetArena(&arena);
+            int wordCount = splitIntoWords(line, &lineWords);
+            lineArray = lineWords.words;
+            if (wordCount == 0 || lineArray[0][0] == COMMENT_SYMBOL)
+            {
+                continue;
+            }
+            replaceDoubleDollarSigns
+            (
+                lineArray,
+                wordCount,
+                &arena,
+                processIdString
+            );
+            expandGlobs(&lineWords, &wordCount, &arena);
+            lineArray = lineWords.words;
+
+            char* commandLine = joinWords(lineArray, wordCount);
+            int stageCount = countPipelineStages(lineArray, wordCount);
+            pid_t stagePids[stageCount];
+            pid_t processGroup = -1;
+
+            started++;
+
+            if
+            (
+                launchPipeline
+                (
+                    lineArray,
+                    wordCount,
+                    stagePids,
+                    DEV_NULL,
+                    NULL,
+                    -1,
+                    FALSE,
+                    &processGroup,
+                    placement,
+                    originalSigintAction,
+                    commandHashTable,
+                    zygote,
+                    NULL
+                ) == FALSE ||
+                stagePids[stageCount - 1] == -1
+            )
+            {
+                // It never ran, which counts as failing. (If only an earlier
+                // stage of a pipeline started, waitpid(-1) reaps it later.)
+                failed++;
+                free(commandLine);
+                continue;
+            }
+
+            // Like the job table, we know a pipeline by its last stage:
+            for (i = 0; slots[i].processID != -1; i++)
+            {
+                // Find a free slot; there must be one.
+            }
+            slots[i].processID = stagePids[stageCount - 1];
+            slots[i].commandLine = commandLine;
+            running++;
+        }
+
+        if (running == 0)
+        {
+            continue;
+        }
+
+        // Wait for something to finish:
+
+        int childExitMethod = -5;
+        struct rusage usage;
+        pid_t processID =
+            waitForChild(eventLoop, jobTable, 0, &childExitMethod, &usage);
+
+        if (processID == -1)
+        {
+            perror("Error when waiting for parallel commands!");
+            break;
+        }
+
+        for (i = 0; i < slotCount; i++)
+        {
+            if (slots[i].processID == processID)
+            {
+                break;
+            }
+        }
+
+        if (i == slotCount)
+        {
+            // Not one of ours, so perhaps a background process (or an
+            // earlier stage of one of our pipelines, which we just ignore):
+            reportFinishedBackgroundProcess
+            (
+                processID,
+                childExitMethod,
+                jobTable,
+                FALSE
+            );
+            continue;
+        }
+
+        if (reportParallelResult(slots[i].commandLine, childExitMethod) ==
+            FALSE)
+        {
+            failed++;
+        }
+        free(slots[i].commandLine);
+        slots[i].processID = -1;
+        slots[i].commandLine = NULL;
+        running--;
+    }
+
+    if (reader == &fileReader)
+    {
+        if (fileReader.fd != STDIN_FILENO)
+        {
+            close(fileReader.fd);
+        }
+        free(fileReader.buffer);
+    }
+    else if (reader->interactive == TRUE)
+    {
+        // At a terminal, Ctrl-D only ends the list of commands, not the shell:
+        reader->atEndOfFile = FALSE;
+    }
+
+    freeArena(&arena);
+    free(lineWords.words);
+    free(slots);
+
+    printf("parallel: %d commands, %d succeeded, %d failed\n", started,
+           started - failed, failed);
+    fflush(stdout);
+
+    *statusValue = (failed > MAX_PARALLEL_FAILURE_STATUS) ?
+                   MAX_PARALLEL_FAILURE_STATUS : failed;
+
+    return;
+}
+
+// This function tells whether "name" is one of the built-in commands that
+// runCommand() handles itself, other than the ones that just run the rest of
+// the command ("time", "timeout", and "on"). None of these start a process,
+// so there is nothing for "timeout" to stop.
+static int isShellBuiltIn(char* name)
+{
+    char* names[] =
+    {
+        EXIT_COMMAND,
+        STATUS_COMMAND,
+        CD_COMMAND,
+        JOBS_COMMAND,
+        WAIT_COMMAND,
+        JOBLOG_COMMAND,
+        HASH_COMMAND,
+        ADMIT_COMMAND,
+        PLACEMENT_COMMAND,
+        PARALLEL_COMMAND,
+        NULL
+    };
+    int i;
+
+    for (i = 0; names[i] != NULL; i++)
+    {
+        if (strcmp(name, names[i]) == 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// This function runs one command of a list (see executeCommandList()): one of
+// the built-in commands that are handled right here, or a command for
+// executeCommand(). timeEveryCommand and timeLimit are passed on to
+// executeCommand(); "time" and "timeout" run the rest of their command
+// through here again with those changed, the way "on" does with placements.
+// Returns FALSE if the command was "exit" (after getting rid of the
+// background processes), and TRUE otherwise.
+static int runCommand
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct inputReader* reader,
+    char* processIdString,
+    int* statusType,
+    int* statusValue,
+    int* usingBackgroundIsPossible,
+    struct jobTable* jobTable,
+    struct eventLoop* eventLoop,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    int timeEveryCommand,
+    double timeLimit,
+    struct placementSettings* placements,
+    struct resourceReport* resourceReport,
+    struct commandTrace* trace
+)
+{
+    // "wait" and "parallel" could go on forever, and we have no way to stop
+    // them, so no built-in command of ours can be given a time limit:
+    if (timeLimit > 0 && isShellBuiltIn(commandArray[0]) == TRUE)
+    {
+        fprintf(stderr, "timeout: can't time out a shell built-in\n");
+        *statusType = EXIT_VALUE;
+        *statusValue = TIMEOUT_FAILURE_STATUS;
+    }
+    // Check to see if we need to invoke one of the built-in commands:
+    else if (strcmp(commandArray[0], EXIT_COMMAND) == 0)
+    {
+        prepForExit(jobTable, eventLoop);
+        return FALSE;
+    }
+    else if (strcmp(commandArray[0], STATUS_COMMAND) == 0)
+    {
+        outputStatus(*statusType, *statusValue, resourceReport);
+    }
+    else if (strcmp(commandArray[0], CD_COMMAND) == 0)
+    {
+        if (arrayElementsUsed == 1)
+        {
+            changeDirectory("");
+        }
+        else
+        {
+            changeDirectory(commandArray[1]);
+        }
+    }
+    else if (strcmp(commandArray[0], JOBS_COMMAND) == 0)
+    {
+        outputJobs(jobTable);
+    }
+    else if (strcmp(commandArray[0], TIME_COMMAND) == 0 &&
+             arrayElementsUsed == 1)
+    {
+        outputResourceReport(resourceReport);
+    }
+    else if (strcmp(commandArray[0], TIME_COMMAND) == 0)
+    {
+        // Run the rest of the command, timing it. (Built-in commands that
+        // are handled here, like "cd", aren't timed, just as with smallsh
+        // -t.)
+        return runCommand
+        (
+            commandArray + 1,
+            arrayElementsUsed - 1,
+            reader,
+            processIdString,
+            statusType,
+            statusValue,
+            usingBackgroundIsPossible,
+            jobTable,
+            eventLoop,
+            originalSigintAction,
+            commandHashTable,
+            zygote,
+            TRUE,
+            timeLimit,
+            placements,
+            resourceReport,
+            trace
+        );
+    }
+    else if (strcmp(commandArray[0], TIMEOUT_COMMAND) == 0)
+    {
+        // Run the rest of the command with a time limit:
+        //   timeout SECONDS COMMAND...
+        // (SECONDS may be a fraction; 0 means no limit.) Inside another
+        // "timeout", whichever limit is shorter applies.
+        char* end = NULL;
+        double commandTimeLimit = -1;
+        if (arrayElementsUsed >= 3)
+        {
+            commandTimeLimit = strtod(commandArray[1], &end);
+        }
+
+        if (commandTimeLimit < 0 || *end != 0 || end == commandArray[1])
+        {
+            fprintf(stderr, "timeout: usage: timeout SECONDS COMMAND...\n");
+            *statusType = EXIT_VALUE;
+            *statusValue = TIMEOUT_FAILURE_STATUS;
+        }
+        else
+        {
+            if (commandTimeLimit == 0 ||
+                (timeLimit > 0 && timeLimit < commandTimeLimit))
+            {
+                commandTimeLimit = timeLimit;
+            }
+
+            return runCommand
+            (
+                commandArray + 2,
+                arrayElementsUsed - 2,
+                reader,
+                processIdString,
+                statusType,
+                statusValue,
+                usingBackgroundIsPossible,
+                jobTable,
+                eventLoop,
+                originalSigintAction,
+                commandHashTable,
+                zygote,
+                timeEveryCommand,
+                commandTimeLimit,
+                placements,
+                resourceReport,
+                trace
+            );
+        }
+    }
+    else if (strcmp(commandArray[0], WAIT_COMMAND) == 0)
+    {
+        waitBuiltIn
+        (
+            commandArray,
+            arrayElementsUsed,
+            jobTable,
+            eventLoop,
+            statusType,
+            statusValue
+        );
+    }
+    else if (strcmp(commandArray[0], JOBLOG_COMMAND) == 0)
+    {
+        jobLogBuiltIn
+        (
+            commandArray,
+            arrayElementsUsed,
+            jobTable,
+            statusType,
+            statusValue
+        );
+    }
+    else if (strcmp(commandArray[0], HASH_COMMAND) == 0)
+    {
+        hashBuiltIn(commandHashTable, commandArray, arrayElementsUsed);
+    }
+    else if (strcmp(commandArray[0], ADMIT_COMMAND) == 0)
+    {
+        admitBuiltIn
+        (
+            commandArray,
+            arrayElementsUsed,
+            jobTable,
+            statusType,
+            statusValue
+        );
+    }
+    else if (strcmp(commandArray[0], PLACEMENT_COMMAND) == 0)
+    {
+        placementBuiltIn
+        (
+            commandArray,
+            arrayElementsUsed,
+            placements,
+            statusType,
+            statusValue
+        );
+    }
+    else if (strcmp(commandArray[0], ON_COMMAND) == 0)
+    {
+        // Run the rest of the command with a placement of its own:
+        //   on [CPUS] [nice N] [io CLASS] [--] COMMAND...
+        // (see parsePlacement() for where the placement ends). It is merged
+        // into both defaults, since COMMAND may end with "&". The rest of
+        // the command goes back through here, so it can be "time",
+        // "timeout", "parallel", or another "on", too. (Commands that we run
+        // ourselves, like "echo" or "cd", don't start a process to place, so
+        // they aren't affected.)
+        struct placement placement;
+        int used = parsePlacement
+        (
+            commandArray + 1,
+            arrayElementsUsed - 1,
+            &placement
+        );
+
+        if (used == 0 || used == arrayElementsUsed - 1)
+        {
+            fprintf(stderr, "on: usage: on [CPUS] [nice N] [io CLASS] [--] "
+                    "COMMAND...\n(The placement ends at the first word that "
+                    "isn't part of it, or at \"--\".)\n");
+            *statusType = EXIT_VALUE;
+            *statusValue = 1;
+        }
+        else
+        {
+            struct placementSettings commandPlacements = *placements;
+            mergePlacement(&commandPlacements.foreground, &placement);
+            mergePlacement(&commandPlacements.background, &placement);
+
+            return runCommand
+            (
+                commandArray + 1 + used,
+                arrayElementsUsed - 1 - used,
+                reader,
+                processIdString,
+                statusType,
+                statusValue,
+                usingBackgroundIsPossible,
+                jobTable,
+                eventLoop,
+                originalSigintAction,
+                commandHashTable,
+                zygote,
+                timeEveryCommand,
+                timeLimit,
+                &commandPlacements,
+                resourceReport,
+                trace
+            );
+        }
+    }
+    else if (strcmp(commandArray[0], PARALLEL_COMMAND) == 0)
+    {
+        runParallel
+        (
+            commandArray,
+            arrayElementsUsed,
+            reader,
+            processIdString,
+            statusType,
+            statusValue,
+            jobTable,
+            eventLoop,
+            originalSigintAction,
+            commandHashTable,
+            zygote,
+            placements
+        );
+    }
+    // And if none of the above is true, then we need to try to execute
+    // this command by forking and executing:
+    else
+    {
+        executeCommand
+        (
+            commandArray,
+            arrayElementsUsed,
+            statusType,
+            statusValue,
+            usingBackgroundIsPossible,
+            jobTable,
+            eventLoop,
+            originalSigintAction,
+            commandHashTable,
+            zygote,
+            timeEveryCommand,
+            timeLimit,
+            placements,
+            resourceReport,
+            trace
+        );
+    }
+
+    return TRUE;
+}
+
+// This function tells whether "word" has ";", "&&", or "||" in it without
+// being just that operator, as in "cd /tmp; ls" or "make&&./a.out". Those
+// operators only count as words of their own, so rather than quietly running
+// something else, we call that a syntax error. (Words that are just an
+// operator have already been dealt with by the time this is called.)
+static int hasGluedListOperator(char* word)
+{
+    char* c;
+
+    for (c = word; *c != 0; c++)
+    {
+        if (*c == LIST_SEPARATOR[0] ||
+            (*c == AND_OPERATOR[0] && c[1] == AND_OPERATOR[1]) ||
+            (*c == OR_OPERATOR[0] && c[1] == OR_OPERATOR[1]))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// This function splits a line's words into a list of commands, at each ";",
+// "&&", and "||". The operator words are replaced by NULLs, so each command
+// ends up with its own NULL-terminated array, like the stages of a pipeline.
+// A command that starts with "#" is a comment, which ends the list. The list
+// is made in the arena, since it's only needed until the next prompt.
+// Returns the list (and its length in *itemCount), or NULL (after reporting
+// the problem) if an operator is missing a command on either side, or is
+// stuck to another word (see hasGluedListOperator()). (A ";" at the very end
+// is fine.)
+static struct commandListItem* parseCommandList
+(
+    char** commandArray,
+    int arrayElementsUsed,
+    struct wordArena* arena,
+    int* itemCount
+)
+{
+    // There can't be more commands than words:
+    struct commandListItem* items = (struct commandListItem*)
+        allocateFromArena(arena, (arrayElementsUsed + 1) * sizeof(*items));
+    int condition = RUN_ALWAYS;
+    int start = 0;
+    int i;
+
+    *itemCount = 0;
+
+    for (i = 0; i <= arrayElementsUsed; i++)
+    {
+        int operator = -1;
+
+        if (i == arrayElementsUsed)
+        {
+            operator = RUN_ALWAYS; // The end of the line.
+        }
+        else if (strcmp(commandArray[i], LIST_SEPARATOR) == 0)
+        {
+            operator = RUN_ALWAYS;
+        }
+        else if (strcmp(commandArray[i], AND_OPERATOR) == 0)
+        {
+            operator = RUN_IF_SUCCEEDED;
+        }
+        else if (strcmp(commandArray[i], OR_OPERATOR) == 0)
+        {
+            operator = RUN_IF_FAILED;
+        }
+        else if (i == start && commandArray[i][0] == COMMENT_SYMBOL)
+        {
+            // The rest of the line is a comment:
+            if (condition != RUN_ALWAYS)
+            {
+                break; // Which leaves "&&" or "||" without a command.
+            }
+            return items;
+        }
+        else if (hasGluedListOperator(commandArray[i]) == TRUE)
+        {
+            fprintf(stderr, "smallsh: syntax error near \"%s\" (\"%s\", "
+                    "\"%s\", and \"%s\" need spaces around them)\n",
+                    commandArray[i], LIST_SEPARATOR, AND_OPERATOR,
+                    OR_OPERATOR);
+            return NULL;
+        }
+
+        if (operator == -1)
+        {
+            continue;
+        }
+
+        if (i == start)
+        {
+            // There's no command before this operator. That's only all right
+            // at the end of a line that ends with ";" (or is empty):
+            if (i == arrayElementsUsed && condition == RUN_ALWAYS)
+            {
+                return items;
+            }
+            break;
+        }
+
+        items[*itemCount].commandArray = &commandArray[start];
+        items[*itemCount].arrayElementsUsed = i - start;
+        items[*itemCount].condition = condition;
+        (*itemCount)++;
+
+        if (i == arrayElementsUsed)
+        {
+            return items;
+        }
+        commandArray[i] = NULL;
+        condition = operator;
+        start = i + 1;
+    }
+
+    fprintf(stderr, "smallsh: syntax error near \"%s\"\n",
+            (i < arrayElementsUsed) ? commandArray[i] :
+            (condition == RUN_IF_SUCCEEDED) ? AND_OPERATOR : OR_OPERATOR);
+    return NULL;
+}
+
+// This function runs a list of commands (see parseCommandList()) in order.
+// "&&" and "||" are decided by statusType and statusValue, which is whatever
+// the last foreground command that ran left in them: a command after "&&" is
+// skipped unless that was "exit value 0", and one after "||" is skipped if it
+// was. Skipping a command doesn't change the status, so "a && b || c" runs c
+// whenever either a or b fails, as in bash. Returns FALSE if one of the
+// commands was "exit".
+static int executeCommandList
+(
+    struct commandListItem* items,
+    int itemCount,
+    struct inputReader* reader,
+    char* processIdString,
+    int* statusType,
+    int* statusValue,
+    int* usingBackgroundIsPossible,
+    struct jobTable* jobTable,
+    struct eventLoop* eventLoop,
+    struct sigaction* originalSigintAction,
+    struct commandHashTable* commandHashTable,
+    struct zygote* zygote,
+    int timeEveryCommand,
+    struct placementSettings* placements,
+    struct resourceReport* resourceReport,
+    struct commandTrace* trace
+)
+{
+    int i;
+    for (i = 0; i < itemCount; i++)
+    {
+        int succeeded = (*statusType == EXIT_VALUE && *statusValue == 0);
+
+        if ((items[i].condition == RUN_IF_SUCCEEDED && succeeded == FALSE) ||
+            (items[i].condition == RUN_IF_FAILED && succeeded == TRUE))
+        {
+            continue;
+        }
+
+        if (i > 0)
+        {
+            restartTrace(trace);
+        }
+
+        if
+        (
+            runCommand
+            (
+                items[i].commandArray,
+                items[i].arrayElementsUsed,
+                reader,
+                processIdString,
+                statusType,
+                statusValue,
+                usingBackgroundIsPossible,
+                jobTable,
+                eventLoop,
+                originalSigintAction,
+                commandHashTable,
+                zygote,
+                timeEveryCommand,
+                0,
+                placements,
+                resourceReport,
+                trace
+            ) == FALSE
+        )
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// The rest of this file is the library's interface (see libsmallsh.h).
+
+struct smallshContext // Everything one shell keeps track of. (Before this was
+                      // a library, main() kept all of this in its own
+                      // variables.)
+{
+    struct inputReader reader; // Reused for every line of input.
+    int haveReader;
+
+    struct wordList wordList; // Grows to fit the longest line.
+    int arrayElementsUsed;
+
+    struct wordArena arena;
+
+    // The list of commands on the line that is being run:
+    struct commandListItem* items;
+    int itemCount;
+
+    // "$$" is replaced by this (see replaceDoubleDollarSigns()):
+    // https://stackoverflow.com/questions/53230155/converting-pid-t-to-string
+    char processIdString[MAX_DIGITS_IN_PROCESS_ID + 1];
+
+    int statusType;
+    int statusValue;
+
+    int usingBackgroundIsPossible; // FALSE in foreground-only mode.
+
+    struct jobTable jobTable;
+
+    struct commandHashTable commandHashTable;
+
+    struct resourceReport resourceReport;
+
+    struct zygote zygote;
+
+    struct commandTrace trace;
+
+    int timeEveryCommand;
+
+    struct placementSettings placements; // Set with "placement".
+
+    struct eventLoop eventLoop;
+    sigset_t shellSignals; // The signals that eventLoop.signalFD receives.
+
+    // How SIGINT and SIGTSTP were handled before we started ignoring them
+    // (commands get the original SIGINT handling back):
+    struct sigaction originalSigintAction;
+    struct sigaction originalSigtstpAction;
+};
+
+struct smallshContext* smallshCreate(int options)
+{
+    struct smallshContext* context = calloc(1, sizeof(*context));
+    if (context == NULL)
+    {
+        perror("Error when allocating memory for the shell!");
+        return NULL;
+    }
+
+    context->haveReader = FALSE;
+    context->wordList.words = NULL;
+    context->arena.first = NULL;
+    context->arena.current = NULL;
+    context->items = NULL;
+    context->itemCount = 0;
+
+    sprintf(context->processIdString, "%d", getpid());
+
+    context->statusType = EXIT_VALUE;
+    context->statusValue = 0;
+    context->usingBackgroundIsPossible = TRUE;
+
+    context->jobTable.slots = NULL;
+    context->jobTable.capacity = 0;
+    context->jobTable.count = 0;
+    context->jobTable.nextJobNumber = 1;
+    context->jobTable.logEpollFD = -1;
+    context->jobTable.finishedLogs = NULL;
+    context->jobTable.finishedLogCount = 0;
+    context->jobTable.nextDeadline = 0;
+    memset(&context->jobTable.admission, 0,
+           sizeof(context->jobTable.admission));
+    context->jobTable.queueHead = NULL;
+    context->jobTable.queueTail = NULL;
+    context->jobTable.queuedCount = 0;
+    context->jobTable.eventLoop = &context->eventLoop;
+    context->jobTable.originalSigintAction = &context->originalSigintAction;
+    context->jobTable.commandHashTable = &context->commandHashTable;
+    context->jobTable.zygote = &context->zygote;
+
+    context->resourceReport.available = FALSE;
+
+    context->zygote.processID = -1;
+    context->zygote.socketFD = -1;
+
+    context->trace.fd = -1;
+    context->trace.commandLine = NULL;
+
+    // Until "placement" says otherwise, commands run wherever the shell does:
+    memset(&context->placements, 0, sizeof(context->placements));
+
+    context->timeEveryCommand =
+        ((options & SMALLSH_TIME_EVERY_COMMAND) != 0) ? TRUE : FALSE;
+
+    // Trace mode (see writeTrace()) is turned on from the environment. The
+    // trace file descriptor is kept away from the commands that we run:
+    char* traceVariable = getenv("SMALLSH_TRACE_FD");
+    if (traceVariable != NULL && traceVariable[0] != 0)
+    {
+        char* end;
+        long traceFD = strtol(traceVariable, &end, 10);
+
+        if (*end != 0 || traceFD < 0 || traceFD > INT_MAX ||
+            fcntl(traceFD, F_SETFD, FD_CLOEXEC) == -1)
+        {
+            fprintf(stderr, "smallsh: SMALLSH_TRACE_FD=%s isn't an open file "
+                    "descriptor; not tracing\n", traceVariable);
+        }
+        else
+        {
+            context->trace.fd = traceFD;
+        }
+    }
+
+    // The shell ignores SIGINT and SIGTSTP (see below), but even so, we need
+    // to know when either one arrives, and when a child finishes. Rather than
+    // with signal handlers, the kernel tells us about all three through a
+    // file descriptor. They have to be blocked for that to work (our children
+    // don't inherit that; see the spawn functions). Linux queues a blocked
+    // signal even if it's ignored.
+    //
+    // The file descriptors are made first, so that if that fails, we can give
+    // up without having changed how the program handles signals:
+
+    struct eventLoop* eventLoop = &context->eventLoop;
+    eventLoop->watchingInput = FALSE;
+    eventLoop->sigchldArrived = FALSE;
+    eventLoop->sigtstpArrived = FALSE;
+    eventLoop->sigintArrived = FALSE;
+
+    sigemptyset(&context->shellSignals);
+    sigaddset(&context->shellSignals, SIGCHLD);
+    sigaddset(&context->shellSignals, SIGTSTP);
+    sigaddset(&context->shellSignals, SIGINT);
+
+    eventLoop->signalFD =
+        signalfd(-1, &context->shellSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+    eventLoop->epollFD = epoll_create1(EPOLL_CLOEXEC);
+    // Background jobs' deadlines (see enforceDeadlines()) share one timer:
+    context->jobTable.timerFD =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (eventLoop->signalFD == -1 || eventLoop->epollFD == -1 ||
+        context->jobTable.timerFD == -1)
+    {
+        perror("Error when setting up the shell's event loop!");
+        int fileDescriptors[3] =
+        {
+            eventLoop->signalFD,
+            eventLoop->epollFD,
+            context->jobTable.timerFD
+        };
+        closeIfOpen(fileDescriptors, 3);
+        free(context);
+        return NULL;
+    }
+
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = eventLoop->signalFD;
+    epoll_ctl(eventLoop->epollFD, EPOLL_CTL_ADD, eventLoop->signalFD, &event);
+    event.data.fd = context->jobTable.timerFD;
+    epoll_ctl(eventLoop->epollFD, EPOLL_CTL_ADD, context->jobTable.timerFD,
+              &event);
+
+    // The zygote should be started while the program is still as small as it
+    // will ever be:
+    if ((options & SMALLSH_USE_ZYGOTE) != 0)
+    {
+        startZygote(&context->zygote);
+    }
+
+    // Make shell ignore SIGINT:
+
+    struct sigaction ignoreAction = {{0}};
+    // https://stackoverflow.com/questions/13746033/how-to-repair-warning-missing-braces-around-initializer
+    ignoreAction.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &ignoreAction, &context->originalSigintAction);
+
+    // Make shell ignore SIGTSTP, too. Children inherit that, which is what
+    // we want for them:
+
+    sigaction(SIGTSTP, &ignoreAction, &context->originalSigtstpAction);
+
+    // From here on, the signals come through eventLoop->signalFD:
+    sigprocmask(SIG_BLOCK, &context->shellSignals, NULL);
+
+    // Background jobs' output pipes (see struct jobLog) get an epoll set of
+    // their own, which is watched along with everything else. That way,
+    // waiting for something else only has to watch one more file descriptor,
+    // however many jobs are running:
+    if ((options & SMALLSH_CAPTURE_BACKGROUND_OUTPUT) != 0)
+    {
+        context->jobTable.logEpollFD = epoll_create1(EPOLL_CLOEXEC);
+        if (context->jobTable.logEpollFD == -1)
+        {
+            perror("Error when setting up background output capture!");
+        }
+        else
+        {
+            event.data.fd = context->jobTable.logEpollFD;
+            epoll_ctl(eventLoop->epollFD, EPOLL_CTL_ADD,
+                      context->jobTable.logEpollFD, &event);
+        }
+    }
+
+    return context;
+}
+
+// This function gets rid of the context's input reader, if it has one, so
+// that a new one can take its place:
+static void closeContextInput(struct smallshContext* context)
+{
+    if (context->haveReader == FALSE)
+    {
+        return;
+    }
+
+    if (context->eventLoop.watchingInput == TRUE)
+    {
+        epoll_ctl(context->eventLoop.epollFD, EPOLL_CTL_DEL,
+                  context->reader.fd, NULL);
+        context->eventLoop.watchingInput = FALSE;
+    }
+    free(context->reader.buffer);
+    context->haveReader = FALSE;
+
+    return;
+}
+
+void smallshSetInputFile
+(
+    struct smallshContext* context,
+    int fd,
+    int interactive
+)
+{
+    closeContextInput(context);
+    openInputReader(&context->reader, fd, interactive);
+    context->haveReader = TRUE;
+
+    // We also wait for input with epoll, so that signals are dealt with
+    // while we wait. (That fails for regular files, which is fine.)
+    struct epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    context->eventLoop.watchingInput =
+        (epoll_ctl(context->eventLoop.epollFD, EPOLL_CTL_ADD, fd, &event) == 0);
+
+    return;
+}
+
+void smallshSetInputString(struct smallshContext* context, const char* text)
+{
+    closeContextInput(context);
+    openStringInputReader(&context->reader, (char*) text);
+    context->haveReader = TRUE;
+
+    return;
+}
+
+// This function takes the words of a line, which are already in
+// context->wordList, and does everything to them that comes before running
+// them: reading here-documents (from "reader", which may be NULL), "$$" and
+// wildcard expansion, and splitting them into a list of commands. Returns the
+// number of commands, or -1 if there's a syntax error (which, as in bash,
+// counts as failing).
+static int prepareCommands
+(
+    struct smallshContext* context,
+    struct inputReader* reader
+)
+{
+    if
+    (
+        collectHereDocuments
+        (
+            &context->wordList,
+            &context->arrayElementsUsed,
+            &context->arena,
+            reader,
+            &context->eventLoop,
+            &context->jobTable,
+            &context->usingBackgroundIsPossible
+        ) == FALSE
+    )
+    {
+        context->items = NULL;
+        context->itemCount = 0;
+        context->statusType = EXIT_VALUE;
+        context->statusValue = 2;
+        return -1;
+    }
+
+    replaceDoubleDollarSigns
+    (
+        context->wordList.words,
+        context->arrayElementsUsed,
+        &context->arena,
+        context->processIdString
+    );
+    expandGlobs(&context->wordList, &context->arrayElementsUsed,
+                &context->arena);
+
+    if (tracing(&context->trace) == TRUE)
+    {
+        context->trace.expandTime = monotonicNanoseconds();
+    }
+
+    context->items = parseCommandList
+    (
+        context->wordList.words,
+        context->arrayElementsUsed,
+        &context->arena,
+        &context->itemCount
+    );
+
+    if (context->items == NULL)
+    {
+        context->itemCount = 0;
+        context->statusType = EXIT_VALUE;
+        context->statusValue = 2;
+        return -1;
+    }
+
+    return context->itemCount;
+}
+
+// This function runs the commands that prepareCommands() found. Returns FALSE
+// if one of them was "exit".
+static int runPreparedCommands(struct smallshContext* context)
+{
+    if (context->haveReader == FALSE)
+    {
+        // "parallel" without a file reads from the shell's input, and this
+        // shell doesn't have any:
+        smallshSetInputString(context, "");
+    }
+
+    return executeCommandList
+    (
+        context->items,
+        context->itemCount,
+        &context->reader,
+        context->processIdString,
+        &context->statusType,
+        &context->statusValue,
+        &context->usingBackgroundIsPossible,
+        &context->jobTable,
+        &context->eventLoop,
+        &context->originalSigintAction,
+        &context->commandHashTable,
+        &context->zygote,
+        context->timeEveryCommand,
+        &context->placements,
+        &context->resourceReport,
+        &context->trace
+    );
+}
+
+int smallshRunNextLine(struct smallshContext* context)
+{
+    if (context->haveReader == FALSE)
+    {
+        return FALSE;
+    }
+
+    handleSignals
+    (
+        &context->eventLoop,
+        &context->jobTable,
+        &context->usingBackgroundIsPossible,
+        FALSE
+    );
+
+    resetArena(&context->arena);
+    // Whatever the last command needed from the arena is no longer needed.
+
+    startTrace(&context->trace);
+
+    if
+    (
+        getCommandArray
+        (
+            &context->reader,
+            &context->wordList,
+            &context->arrayElementsUsed,
+            &context->eventLoop,
+            &context->jobTable,
+            &context->usingBackgroundIsPossible,
+            &context->trace
+        ) == FALSE
+    )
+    {
+        // We've run out of input, which means the same thing as "exit".
+        prepForExit(&context->jobTable, &context->eventLoop);
+        return FALSE;
+    }
+
+    if (prepareCommands(context, &context->reader) == -1)
+    {
+        return TRUE;
+    }
+
+    return runPreparedCommands(context);
+}
+
+int smallshParse(struct smallshContext* context, const char* line)
+{
+    resetArena(&context->arena);
+    startTrace(&context->trace);
+
+    // The words are split apart in place, so the line gets a copy of its own:
+    size_t length = strlen(line);
+    char* copy = allocateFromArena(&context->arena, length + 1);
+    memcpy(copy, line, length + 1);
+
+    // Only the first line is a command; any lines after it are for its
+    // here-documents:
+    struct inputReader moreLines;
+    struct inputReader* hereDocumentReader = NULL;
+    char* newline = strchr(copy, '\n');
+    if (newline != NULL)
+    {
+        *newline = 0;
+        openStringInputReader(&moreLines, newline + 1);
+        hereDocumentReader = &moreLines;
+    }
+
+    if (tracing(&context->trace) == TRUE)
+    {
+        context->trace.readTime = monotonicNanoseconds();
+    }
+
+    context->arrayElementsUsed = splitIntoWords(copy, &context->wordList);
+
+    if (tracing(&context->trace) == TRUE)
+    {
+        context->trace.tokenizeTime = monotonicNanoseconds();
+    }
+
+    int commandCount = prepareCommands(context, hereDocumentReader);
+
+    if (hereDocumentReader != NULL)
+    {
+        free(moreLines.buffer);
+    }
+
+    return commandCount;
+}
+
+char** smallshCommandWords
+(
+    struct smallshContext* context,
+    int index,
+    int* wordCount
+)
+{
+    if (index < 0 || index >= context->itemCount)
+    {
+        *wordCount = 0;
+        return NULL;
+    }
+
+    *wordCount = context->items[index].arrayElementsUsed;
+    return context->items[index].commandArray;
+}
+
+int smallshRun(struct smallshContext* context, const char* line)
+{
+    if (smallshParse(context, line) == -1)
+    {
+        return TRUE;
+    }
+
+    return runPreparedCommands(context);
+}
+
+int smallshPollJobs(struct smallshContext* context)
+{
+    handleSignals
+    (
+        &context->eventLoop,
+        &context->jobTable,
+        &context->usingBackgroundIsPossible,
+        FALSE
+    );
+
+    return context->jobTable.count + context->jobTable.queuedCount;
+}
+
+void smallshGetStatus(struct smallshContext* context, int* exited, int* value)
+{
+    *exited = (context->statusType == EXIT_VALUE) ? TRUE : FALSE;
+    *value = context->statusValue;
+
+    return;
+}
+
+void smallshDestroy(struct smallshContext* context)
+{
+    prepForExit(&context->jobTable, &context->eventLoop);
+    free(context->jobTable.slots);
+
+    while (context->jobTable.finishedLogs != NULL)
+    {
+        struct jobLog* log = context->jobTable.finishedLogs;
+        context->jobTable.finishedLogs = log->next;
+        freeJobLog(&context->jobTable, log);
+    }
+    if (context->jobTable.logEpollFD != -1)
+    {
+        close(context->jobTable.logEpollFD);
+    }
+    close(context->jobTable.timerFD);
+
+    if (context->zygote.socketFD != -1)
+    {
+        // The zygote exits when its socket is closed:
+        close(context->zygote.socketFD);
+        waitpid(context->zygote.processID, NULL, 0);
+    }
+
+    closeContextInput(context);
+    free(context->wordList.words);
+    freeArena(&context->arena);
+    clearCommandHashTable(&context->commandHashTable);
+    free(context->commandHashTable.pathVariable);
+    free(context->commandHashTable.uncachedPath);
+
+    close(context->eventLoop.epollFD);
+    close(context->eventLoop.signalFD);
+    sigprocmask(SIG_UNBLOCK, &context->shellSignals, NULL);
+    sigaction(SIGINT, &context->originalSigintAction, NULL);
+    sigaction(SIGTSTP, &context->originalSigtstpAction, NULL);
+
+    free(context);
+
+    return;
+}
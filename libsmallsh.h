@@ -0,0 +1,107 @@
+// libsmallsh
+// By George Hill
+
+// Everything that smallsh does, other than deciding where its commands come
+// from, as a library: reading and parsing lines, "$$" and wildcard expansion,
+// the job table, and running commands. smallsh.c is just a main() that uses
+// it, and bench.c is a benchmark that uses it directly.
+//
+// All of a shell's state is kept in a struct smallshContext, so nothing here
+// uses global variables. Two things are shared by the whole process, though,
+// because the kernel only has one of each: a context takes over SIGCHLD,
+// SIGINT, and SIGTSTP while it exists (SIGINT and SIGTSTP are ignored, as a
+// shell should, and all three are delivered through a signalfd), and the
+// children it waits for are the process's children. So only one context
+// should be running commands at a time.
+
+// 80 Columns: /////////////////////////////////////////////////////////////////
+
+#ifndef LIBSMALLSH_H
+#define LIBSMALLSH_H
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define SMALLSH_TIME_EVERY_COMMAND 1
+// An option for smallshCreate(): report the time and resources that every
+// foreground command used, as with "time" (smallsh -t).
+#define SMALLSH_USE_ZYGOTE 2
+// An option for smallshCreate(): start commands from a zygote process (smallsh
+// -z). The zygote is started right away, so a context with this option should
+// be created while the program is still small.
+#define SMALLSH_CAPTURE_BACKGROUND_OUTPUT 4
+// An option for smallshCreate(): instead of sending background commands'
+// output to /dev/null, keep the end of it (stdout and stderr together) in
+// memory for "joblog" (smallsh -b).
+
+struct smallshContext; // Everything one shell keeps track of.
+
+// This function creates a shell. "options" is 0 or any of the SMALLSH_ options
+// above, added together. The shell has no input until smallshSetInputFile()
+// or smallshSetInputString() is called; smallshParse() and smallshRun() don't
+// need any. Trace mode (see writeTrace() in libsmallsh.c) is turned on if the
+// SMALLSH_TRACE_FD environment variable is set. If the shell can't be set up
+// (out of memory or file descriptors), this reports why on stderr and returns
+// NULL, without having changed how the program handles signals.
+struct smallshContext* smallshCreate(int options);
+
+// These functions set where smallshRunNextLine() (and "parallel" without a
+// file) get lines from: a file descriptor (with prompts if "interactive" is
+// TRUE), or a copy of the given text.
+void smallshSetInputFile
+(
+    struct smallshContext* context,
+    int fd,
+    int interactive
+);
+void smallshSetInputString(struct smallshContext* context, const char* text);
+
+// This function reads the next line of input (outputting the prompt first, if
+// the input is interactive) and runs it. Returns FALSE when the shell should
+// stop: the line ran "exit", or there is no more input.
+int smallshRunNextLine(struct smallshContext* context);
+
+// This function splits "line" into words, expands "$$" and wildcards, and
+// splits the words into a list of commands at ";", "&&", and "||", without
+// running anything. Returns the number of commands, or -1 (after reporting
+// the problem) if the line has a syntax error. The results stay valid until
+// the next call to smallshParse() or smallshRun(). If "line" has more than
+// one line in it, the ones after the first are only used as the bodies of
+// its here-documents ("cat <<END").
+int smallshParse(struct smallshContext* context, const char* line);
+
+// This function returns the words of command number "index" (counting from 0)
+// of the last line that was parsed, NULL-terminated, and puts how many there
+// are in *wordCount. Returns NULL if there's no such command.
+char** smallshCommandWords
+(
+    struct smallshContext* context,
+    int index,
+    int* wordCount
+);
+
+// This function parses "line" and runs it, just as if it had been typed at
+// the prompt. Returns FALSE if it ran "exit" (after the background processes
+// have been stopped), and TRUE otherwise.
+int smallshRun(struct smallshContext* context, const char* line);
+
+// This function reaps any background processes that have finished, reporting
+// each one as it would be reported at the prompt, and never waits. Returns
+// how many background processes are still running, plus how many background
+// commands are still queued (see "admit" in libsmallsh.c).
+int smallshPollJobs(struct smallshContext* context);
+
+// This function puts what "status" would show into *exited (TRUE for "exit
+// value", FALSE for "terminated by signal") and *value.
+void smallshGetStatus(struct smallshContext* context, int* exited, int* value);
+
+// This function stops any background processes that are still running, as
+// "exit" does (SIGTERM, and then SIGKILL for any that are still running after
+// SMALLSH_GRACE_PERIOD seconds), stops the zygote, gives back everything the
+// shell allocated, and puts SIGCHLD, SIGINT, and SIGTSTP back the way they
+// were.
+void smallshDestroy(struct smallshContext* context);
+
+#endif